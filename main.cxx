@@ -3,6 +3,10 @@
 #include <string>
 #include <cstdio>
 #include <iostream>
+#include <fstream>
+#include <random>
+#include <algorithm>
+#include <omp.h>
 #include "src/main.hxx"
 
 using namespace std;
@@ -18,56 +22,418 @@ using namespace std;
 
 
 
-template <class G, class K, class V>
-double getModularity(const G& x, const CopraResult<K>& a, V M) {
+template <class G, class K, class W, class V>
+double getModularity(const G& x, const CopraResult<K, W>& a, V M) {
   auto fc = [&](auto u) { return a.membership[u]; };
-  return modularityBy(x, fc, M, V(1));
+  return modularityByOmp(x, fc, M, V(1));
+}
+
+
+template <template <class, class, size_t> class LABELSETS, class G>
+double getLabelsetsMegabytes(const G& x, int labels) {
+  using K = typename G::key_type;
+  using V = typename G::edge_value_type;
+  return copraDispatchLabels(labels, [&](auto L) {
+    LABELSETS<K, V, decltype(L)::value> vcom(x.span());
+    return copraLabelsetsBytes(vcom) / 1e6;
+  });
+}
+
+
+template <class G, class V>
+void runCopra(const G& x, V M, int repeat, float tolerance, int labels, bool unweighted, bool selfLoops) {
+  using K = typename G::key_type;
+  vector<K> *init = nullptr;
+  CopraOptions p(repeat, tolerance);
+  p.maxLabels = labels;
+  {
+    // Find COPRA using a single thread.
+    auto ak = copraSeqStaticLabels(x, init, p);
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqStatic {labels=%02d, tolerance=%.0e, labelsets=%.3fMB}\n", ak.time, ak.iterations, getModularity(x, ak, M), labels, tolerance, getLabelsetsMegabytes<LabelsetVector>(x, labels));
+  }
+  {
+    // Find COPRA using a single thread, with compact labelsets.
+    auto ak = copraSeqStaticLabels<CompactLabelsets>(x, init, p);
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqStaticCompact {labels=%02d, tolerance=%.0e, labelsets=%.3fMB}\n", ak.time, ak.iterations, getModularity(x, ak, M), labels, tolerance, getLabelsetsMegabytes<CompactLabelsets>(x, labels));
+  }
+  {
+    // Find COPRA using a single thread, with compact labelsets and 16-bit coefficients.
+    auto ak = copraSeqStaticLabels<QuantizedLabelsets>(x, init, p);
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqStaticQuantized {labels=%02d, tolerance=%.0e, labelsets=%.3fMB}\n", ak.time, ak.iterations, getModularity(x, ak, M), labels, tolerance, getLabelsetsMegabytes<QuantizedLabelsets>(x, labels));
+  }
+  {
+    // Find COPRA using a single thread, sorting all scanned labels.
+    CopraOptions o = p; o.fullSort = true;
+    auto ak = copraSeqStaticLabels(x, init, o);
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqStaticSort {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), labels, tolerance);
+  }
+  {
+    // Find COPRA using a single thread, synchronously.
+    CopraOptions o = p; o.synchronous = true;
+    auto ak = copraSeqStaticLabels(x, init, o);
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqStaticSync {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), labels, tolerance);
+  }
+  {
+    // Find COPRA using a single thread, stopping when community counts do not change (as in paper).
+    CopraOptions o = p; o.convergence = CopraConvergence::COUNT;
+    auto ak = copraSeqStaticLabels(x, init, o);
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqStaticCount {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), labels, tolerance);
+  }
+  {
+    // Find COPRA using a single thread, stopping when belonging coefficients settle.
+    CopraOptions o = p; o.convergence = CopraConvergence::BELONGING;
+    auto ak = copraSeqStaticLabels(x, init, o);
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqStaticBelonging {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), labels, tolerance);
+  }
+  {
+    // Find COPRA using a single thread, skipping vertices whose community set has not changed for 2 iterations.
+    CopraOptions o = p; o.stableIterations = 2;
+    auto ak = copraSeqStaticLabels(x, init, o);
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqStaticStable {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), labels, tolerance);
+  }
+  {
+    // Find COPRA using a single thread, with kernels specialized for graph traits (unweighted, no self-loops).
+    CopraOptions o = p; o.unweighted = unweighted; o.selfLoops = selfLoops;
+    auto ak = copraSeqStaticLabels(x, init, o);
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqStaticTraits {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), labels, tolerance);
+  }
+  {
+    // Find COPRA using multiple threads.
+    auto ak = copraOmpStaticLabels(x, init, p);
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraOmpStatic {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), labels, tolerance);
+  }
+  {
+    // Find COPRA using multiple threads, with kernels specialized for graph traits.
+    CopraOptions o = p; o.unweighted = unweighted; o.selfLoops = selfLoops;
+    auto ak = copraOmpStaticLabels(x, init, o);
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraOmpStaticTraits {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), labels, tolerance);
+  }
+  {
+    // Find COPRA using multiple threads, scanning into per-thread hash tables (or small vectors).
+    CopraOptions o = p; o.hashScan = true;
+    auto ak = copraOmpStaticLabels(x, init, o);
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraOmpStaticHash {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), labels, tolerance);
+  }
+  {
+    // Find COPRA using multiple threads, splitting scans of vertices with degree above COPRA_HUB_CHUNK (the minimum) across threads.
+    CopraOptions o = p; o.hubDegree = COPRA_HUB_CHUNK;
+    auto ak = copraOmpStaticLabels(x, init, o);
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraOmpStaticHubs {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), labels, tolerance);
+  }
+  {
+    // Find COPRA using multiple threads, with (overlapping) modularity found after the last iteration.
+    CopraOptions o = p; o.computeModularity = true;
+    auto ak = copraOmpStaticLabels(x, init, o);
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraOmpStaticModularity {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, ak.modularity, labels, tolerance);
+  }
+  {
+    // Find COPRA using a single thread, with a worklist of active vertices.
+    auto ak = copraDispatchLabels(labels, [&](auto L) { return copraSeqWorklistStatic<decltype(L)::value>(x, init, p); });
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqWorklistStatic {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), labels, tolerance);
+  }
+  {
+    // Find COPRA using multiple threads, with a worklist of active vertices.
+    auto ak = copraDispatchLabels(labels, [&](auto L) { return copraOmpWorklistStatic<decltype(L)::value>(x, init, p); });
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraOmpWorklistStatic {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), labels, tolerance);
+  }
+  {
+    // Find COPRA using multiple threads, synchronously.
+    CopraOptions o = p; o.synchronous = true;
+    auto ak = copraOmpStaticLabels(x, init, o);
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraOmpStaticSync {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), labels, tolerance);
+  }
+}
+
+
+template <class G>
+void runBatchUpdate(const G& x) {
+  using K = typename G::key_type;
+  using V = typename G::edge_value_type;
+  using O = typename G::offset_type;
+  default_random_engine rnd(42);
+  K S = x.span();
+  DiGraphCsrSlack<K, typename G::vertex_value_type, V, O> xs;
+  vector<V> vtot(S);
+  float tg = measureDuration([&]() { graphCsrSlackOmpW(xs, x); });
+  printf("[%09.3f ms] graphCsrSlackOmpW {arrays=%zu}\n", tg, xs.ekeys.size());
+  copraVertexWeightsOmp(vtot, x);
+  for (double f=1e-7; f<=0.1; f*=10) {
+    size_t batchSize = max(size_t(f * x.size()/2), size_t(1));
+    auto deletions  = generateEdgeDeletions (rnd, x, batchSize/5);
+    auto insertions = generateEdgeInsertions(rnd, x, batchSize - batchSize/5, V(1));
+    auto ys = xs;
+    auto wtot = vtot;
+    auto ds = deletions;
+    auto is = insertions;
+    // Rebuild the graph, and then update weights of endpoints from their edges.
+    G y;
+    float tu = measureDuration([&]() {
+      tidyBatchUpdateU(deletions, insertions);
+      applyBatchUpdateOmpW(y, x, deletions, insertions);
+      copraUpdateVertexWeightsOmpW(wtot, y, deletions, insertions);
+    });
+    printf("[%09.3f ms] batchUpdateRebuild {batch=%.0e, deletions=%zu, insertions=%zu}\n", tu, f, deletions.size()/2, insertions.size()/2);
+    // Update the graph in place, and weights of endpoints from edges that changed.
+    wtot = vtot;
+    float ts = measureDuration([&]() {
+      tidyBatchUpdateOmpU(ds, is);
+      applyBatchUpdateSlackOmpU(ys, ds, is, [&](auto u, auto v, auto w, bool ins) { wtot[u] += ins? w : -w; });
+    });
+    printf("[%09.3f ms] batchUpdateSlack {batch=%.0e, size=%zu, arrays=%zu}\n", ts, f, ys.size(), ys.ekeys.size());
+  }
+}
+
+
+template <size_t LABELS, class G>
+void runCopraDynamic(const G& x, int repeat, float tolerance) {
+  using K = typename G::key_type;
+  using V = typename G::edge_value_type;
+  using W = CopraWorkspace<K, V, LabelsetVector<K, V, LABELS>>;
+  vector<K> *init = nullptr;
+  default_random_engine rnd(42);
+  K S = x.span();
+  // Communities of the original graph, which each dynamic approach resumes from.
+  CopraOptions o(1, tolerance);
+  o.saveLabelsets = true;
+  auto a0 = copraOmpStatic<LABELS>(x, init, o);
+  auto fr = [&](W& w) {
+    w.resizeLabelsets(S);
+    copraExpandLabelsetsW(w.vcom, a0.labelsetOffsets, a0.labelsets);
+    copraVertexWeightsOmp(w.vtot, x);
+  };
+  for (double f=1e-7; f<=0.1; f*=10) {
+    size_t batchSize = max(size_t(f * x.size()/2), size_t(1));
+    auto deletions  = generateEdgeDeletions (rnd, x, batchSize/5);
+    auto insertions = generateEdgeInsertions(rnd, x, batchSize - batchSize/5, V(1));
+    tidyBatchUpdateU(deletions, insertions);
+    G y;
+    float tu = measureDuration([&]() { applyBatchUpdateOmpW(y, x, deletions, insertions); });
+    auto M = edgeWeight(y)/2;
+    printf("[%09.3f ms] applyBatchUpdateOmpW {batch=%.0e, deletions=%zu, insertions=%zu}\n", tu, f, deletions.size()/2, insertions.size()/2);
+    // Time each dynamic approach from the state left by the previous run, including its
+    // update of vertex weights, and marking of affected vertices.
+    auto fd = [&](const char *name, auto fn) {
+      W w; float t = 0;
+      for (int r=0; r<repeat; ++r) {
+        fr(w);
+        auto t0 = timeNow();
+        auto ak = fn(w);
+        t += durationMilliseconds(t0, timeNow());
+        if (r<repeat-1) continue;
+        printf("[%09.3f ms; %04d iters.; %01.9f modularity] %s {labels=%02d, tolerance=%.0e}\n", t/repeat, ak.iterations, getModularity(y, ak, M), name, int(LABELS), tolerance);
+      }
+    };
+    {
+      auto ak = copraOmpStatic<LABELS>(y, init, {repeat, tolerance});
+      printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraOmpStatic {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(y, ak, M), int(LABELS), tolerance);
+    }
+    fd("copraOmpNaiveDynamic", [&](W& w) {
+      w.freshWeights = true;
+      copraUpdateVertexWeightsOmpW(w.vtot, y, deletions, insertions);
+      return copraOmpW(w, y, &w.vcom, {1, tolerance});
+    });
+    fd("copraOmpDynamicFrontier", [&](W& w) {
+      return copraOmpDynamicFrontierW(w, y, deletions, insertions, &w.vcom, {1, tolerance});
+    });
+    fd("copraOmpDynamicDeltaScreening", [&](W& w) {
+      return copraOmpDynamicDeltaScreeningW(w, y, deletions, insertions, &w.vcom, {1, tolerance});
+    });
+  }
+}
+
+
+template <class G, class V>
+void runCopraReorder(const G& x, V M, int repeat, float tolerance) {
+  using K = typename G::key_type;
+  vector<K> *init = nullptr;
+  // Reordering pays for itself if its time is less than that saved in iterations.
+  for (const char *order : {"none", "degree", "bfs", "rcm"}) {
+    G y; vector<K> ks;
+    float tr = measureDuration([&]() {
+      ks = vertexOrder(x, order);
+      relabelVerticesOmpW(y, x, ks);
+    });
+    auto ak = copraOmpStatic(y, init, {repeat, tolerance});
+    float tm = measureDuration([&]() { copraRestoreOrderU(ak, ks); });
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraOmpStaticReorder {order=%s, tolerance=%.0e} reorder=%.3f copra=%.3f restore=%.3f\n", tr + ak.time + tm, ak.iterations, getModularity(x, ak, M), order, tolerance, tr, ak.time, tm);
+  }
 }
 
 
 template <class G>
-void runExperiment(const G& x, int repeat) {
+void runCopraCommunities(const G& x, const string& pth, float tolerance) {
   using K = typename G::key_type;
   using V = typename G::edge_value_type;
   vector<K> *init = nullptr;
+  // Communities are built from saved labelsets, and written without text formatting.
+  // The file only checks the round-trip, so it is removed after reading it back.
+  for (int labels : {1, 4, 8}) {
+    CopraOptions o(1, tolerance);
+    o.saveLabelsets = true; o.maxLabels = labels;
+    auto ak = copraOmpStaticLabels(x, init, o);
+    CopraCommunities<K, V> a, b;
+    copraCommunitiesOmpW(a, x, ak);
+    bool ok = false;
+    float tw = measureDuration([&]() { ok = writeCopraCommunitiesBin(pth, a); });
+    if (!ok) { fprintf(stderr, "Cannot write communities %s\n", pth.c_str()); return; }
+    float tr = measureDuration([&]() { ok = readCopraCommunitiesBinW(b, pth); });
+    remove(pth.c_str());
+    ok = ok && a.ids==b.ids && a.offsets==b.offsets && a.members==b.members && a.belongings==b.belongings;
+    printf("[%09.3f ms] copraCommunitiesOmpW {labels=%02d, tolerance=%.0e} communities=%zu members=%zu overlapping=%zu maxSize=%zu write=%.3f read=%.3f bytes=%zu%s\n", a.time, labels, tolerance, a.communities(), a.members.size(), a.overlapping, a.maxSize, tw, tr, a.bytes(), ok? "" : " MISMATCH");
+  }
+}
+
+
+template <class G, class V>
+void runCopraTrace(const G& x, V M, const string& pth, float tolerance) {
+  using K = typename G::key_type;
+  vector<K> *init = nullptr;
+  // Per-phase and per-iteration times of one traced run are written as JSON, for plotting.
+  CopraOptions o(1, tolerance);
+  o.maxLabels = 4;
+  auto ak = copraOmpStaticLabels<LabelsetVector, true>(x, init, o);
+  ofstream f(pth);
+  writeCopraTraceJson(f, ak.trace);
+  f << "\n";
+  f.close();
+  if (!f) { fprintf(stderr, "Cannot write trace %s\n", pth.c_str()); return; }
+  const auto& tr = ak.trace;
+  printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraOmpStaticTrace {labels=%02d, tolerance=%.0e} vertexWeights=%.3f initialize=%.3f extract=%.3f trace=%s\n", ak.time, ak.iterations, getModularity(x, ak, M), o.maxLabels, tolerance, tr.vertexWeightsTime, tr.initializeTime, tr.extractTime, pth.c_str());
+}
+
+
+template <class G, class V>
+void runCopraMultiStart(const G& x, V M, float tolerance) {
+  // Independent seeded runs share the graph, so only memberships grow with runs.
+  for (int runs : {1, 4, 16}) {
+    auto am = copraMultiStartOmp(x, {1, tolerance}, runs, 0, true);
+    auto fc = [&](auto u) { return am.consensus[u]; };
+    double qc = modularityByOmp(x, fc, M, V(1));
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraMultiStartOmp {runs=%02d, tolerance=%.0e} best=%d consensus=%.9f consensusTime=%.3f\n", am.time, am.best.iterations, getModularity(x, am.best, M), runs, tolerance, am.bestRun, qc, am.consensusTime);
+  }
+}
+
+
+template <class G, class V>
+void runCopraStream(const G& x, V M, const string& cache, float tolerance) {
+  using K = typename G::key_type;
+  using E = typename G::edge_value_type;
+  using O = typename G::offset_type;
+  BinStream<K, E, O> s(cache);
+  if (!s) return;
+  // Time waiting for partitions to be read, versus processing them, helps size memory.
+  for (size_t parts : {1, 8, 64}) {
+    auto as = copraSeqStream(s, {1, tolerance}, (x.size() + parts-1) / parts);
+    auto& st = as.stats;
+    printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqStream {partitions=%zu, tolerance=%.0e} read=%.3f wait=%.3f compute=%.3f partition=%.3fMB\n", as.result.time, as.result.iterations, getModularity(x, as.result, M), st.partitions, tolerance, st.readTime, st.waitTime, st.computeTime, st.maxBytes / 1e6);
+  }
+}
+
+
+template <size_t LABELS, class G, class V>
+void runSweepLabels(vector<SweepResult>& a, const G& x, const vector<V>& vtot, V M, const string& graph, const SweepOptions& s, int labels, bool unweighted, bool selfLoops) {
+  using K = typename G::key_type;
+  CopraWorkspace<K, V, LabelsetVector<K, V, LABELS>> w;
+  vector<K> *init = nullptr;
+  w.sharedWeights = &vtot;
+  for (float tolerance : s.tolerances) {
+    for (const string& engine : s.engines) {
+      bool omp  = engine.rfind("omp", 0)==0;
+      bool sort = engine.find("Sort")!=string::npos;
+      bool sync = engine.find("Sync")!=string::npos;
+      bool hash = engine.find("Hash")!=string::npos;
+      int hubDegree = omp? s.hubDegree : 0;
+      CopraConvergence convergence = CopraConvergence::LABEL;
+      readSweepConvergence(s.convergence, convergence);
+      CopraOptions o(1, tolerance, s.maxIterations);
+      o.fullSort  = sort;
+      o.synchronous = sync;
+      o.maxLabels = labels;
+      o.hashScan  = hash;
+      o.hubDegree = hubDegree;
+      o.convergence = convergence;
+      o.stableIterations = s.stableIterations;
+      o.seed = s.seed;
+      o.unweighted = unweighted;
+      o.selfLoops  = selfLoops;
+      SweepResult r;
+      r.graph  = graph;
+      r.order  = s.order;
+      r.engine = engine;
+      r.labels = labels;
+      r.tolerance = tolerance;
+      r.threads   = omp? omp_get_max_threads() : 1;
+      r.hubDegree = hubDegree;
+      r.convergence = s.convergence;
+      r.stableIterations = s.stableIterations;
+      r.seed   = s.seed;
+      r.repeat = s.repeat;
+      vector<float> tt, ts, ti;
+      // Vertex weights are shared by all runs, so only initialization is timed as setup.
+      w.resizeLabelsets(x.span(), sync);
+      for (int i=0; i<s.repeat; ++i) {
+        auto ak = omp? copraOmpW(w, x, init, o) : copraSeqW(w, x, init, o);
+        tt.push_back(ak.time);
+        ts.push_back(ak.setupTime);
+        ti.push_back(ak.time - ak.setupTime);
+        if (i<s.repeat-1) continue;
+        r.iterations = ak.iterations;
+        r.modularity = getModularity(x, ak, M);
+      }
+      r.time = sweepStatistics(tt);
+      r.setupTime     = sweepStatistics(ts);
+      r.iterationTime = sweepStatistics(ti);
+      printf("[%09.3f ms; %04d iters.; %01.9f modularity] %s {labels=%02d, tolerance=%.0e} min=%.3f stddev=%.3f setup=%.3f iterations=%.3f\n", r.time.median, r.iterations, r.modularity, engine.c_str(), labels, tolerance, r.time.min, r.time.stddev, r.setupTime.median, r.iterationTime.median);
+      a.push_back(r);
+    }
+  }
+}
+
+
+template <class G>
+void runSweep(const G& x, const string& graph, const SweepOptions& s, bool unweighted, bool selfLoops) {
+  using V = typename G::edge_value_type;
+  vector<SweepResult> a;
+  // Reorder vertices once for all runs (modularity does not depend upon vertex ids).
+  G y; float tr = 0;
+  if (s.order!="none") {
+    tr = measureDuration([&]() { relabelVerticesOmpW(y, x, vertexOrder(x, s.order)); });
+    printf("[%09.3f ms] relabelVerticesOmpW {order=%s}\n", tr, s.order.c_str());
+  }
+  const G& xr = s.order!="none"? y : x;
+  vector<V> vtot(xr.span());
+  auto M = edgeWeight(xr)/2;
+  float tw = measureDuration([&]() { if (unweighted) copraVertexWeightsOmp<true>(vtot, xr); else copraVertexWeightsOmp(vtot, xr); });
+  printf("[%09.3f ms] copraVertexWeightsOmp\n", tw);
+  // Labels are dispatched at runtime, to kernels with a fixed capacity.
+  for (int l : s.labels)
+    copraDispatchLabels(l, [&](auto L) { runSweepLabels<decltype(L)::value>(a, xr, vtot, V(M), graph, s, l, unweighted, selfLoops); });
+  for (auto& r : a)
+    r.reorderTime = tr;
+  if (!s.csv.empty())  { ofstream f(s.csv);  writeSweepCsv(f, a); }
+  if (!s.json.empty()) { ofstream f(s.json); writeSweepJson(f, a); }
+}
+
+
+template <class G>
+void runExperiment(const G& x, int repeat, const string& cache, bool unweighted, bool selfLoops) {
   auto M = edgeWeight(x)/2;
   auto Q = modularity(x, M, 1.0f);
   printf("[%01.6f modularity] noop\n", Q);
-  CopraOptions o = {repeat};
 
   for (int i=0, f=10; f<=10000; f*=i&1? 5:2, ++i) {
     float tolerance = 1.0f / f;
-    {
-      // Find COPRA using a single thread (1 labels).
-      auto ak = copraSeqStatic<1>(x, init, {repeat, tolerance});
-      printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqStatic {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), 1, tolerance);
-    }
-    {
-      // Find COPRA using a single thread (2 labels).
-      auto ak = copraSeqStatic<2>(x, init, {repeat, tolerance});
-      printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqStatic {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), 2, tolerance);
-    }
-    {
-      // Find COPRA using a single thread (4 labels).
-      auto ak = copraSeqStatic<4>(x, init, {repeat, tolerance});
-      printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqStatic {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), 4, tolerance);
-    }
-    {
-      // Find COPRA using a single thread (8 labels).
-      auto ak = copraSeqStatic<8>(x, init, {repeat, tolerance});
-      printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqStatic {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), 8, tolerance);
-    }
-    {
-      // Find COPRA using a single thread (16 labels).
-      auto ak = copraSeqStatic<16>(x, init, {repeat, tolerance});
-      printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqStatic {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), 16, tolerance);
-    }
-    {
-      // Find COPRA using a single thread (32 labels).
-      auto ak = copraSeqStatic<32>(x, init, {repeat, tolerance});
-      printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraSeqStatic {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), 32, tolerance);
-    }
+    for (int labels : {1, 2, 4, 8, 16, 32})
+      runCopra(x, M, repeat, tolerance, labels, unweighted, selfLoops);
   }
+  runBatchUpdate(x);
+  runCopraDynamic<1>(x, repeat, 0.05f);
+  runCopraDynamic<4>(x, repeat, 0.05f);
+  runCopraReorder(x, M, repeat, 0.05f);
+  runCopraMultiStart(x, M, 0.05f);
+  runCopraStream(x, M, cache, 0.05f);
+  runCopraCommunities(x, cache.substr(0, cache.rfind(".csr")) + ".communities", 0.05f);
+  runCopraTrace(x, M, cache.substr(0, cache.rfind(".csr")) + ".trace.json", 0.05f);
 }
 
 
@@ -75,14 +441,39 @@ int main(int argc, char **argv) {
   using K = int;
   using V = TYPE;
   char *file = argv[1];
-  int repeat = argc>2? stoi(argv[2]) : 5;
-  OutDiGraph<K, None, V> x;  // V w = 1;
-  printf("Loading graph %s ...\n", file);
-  readMtxW<true>(x, file); println(x);
-  auto y = symmetricize(x); print(y); printf(" (symmetricize)\n");
-  // auto fl = [](auto u) { return true; };
-  // selfLoopU(y, w, fl); print(y); printf(" (selfLoopAllVertices)\n");
-  runExperiment(y, repeat);
+  // Sweep over a parameter grid, if options are given (see SweepOptions).
+  bool sweep = argc>2 && argv[2][0]=='-';
+  SweepOptions so;
+  if (sweep && !readSweepOptionsW(so, argc, argv, 2)) {
+    fprintf(stderr, "Usage: %s <graph.mtx> [repeat | --labels=1,4 --tolerances=0.1,0.01 --engines=seq,omp,seqSort,ompSync,ompHash --repeat=5 --max-iterations=20 --order=none|degree|bfs|rcm --hub-degree=0 --convergence=label|count|belonging --stable-iterations=0 --seed=0 --csv=<file> --json=<file>]\n", argv[0]);
+    return 1;
+  }
+  int repeat = !sweep && argc>2? stoi(argv[2]) : 5;
+  printf("OMP_NUM_THREADS=%d\n", omp_get_max_threads());
+  DiGraphCsr<K, None, V> z;  // V w = 1;
+  string cache = string(file) + ".csr";
+  bool cached = false;
+  float tb = measureDuration([&]() { cached = readBinW(z, cache, BIN_SYMMETRIC | BIN_SORTED, file); });
+  if (cached) { print(z); printf(" (readBinW: %.3f ms)\n", tb); }
+  else {
+    printf("Loading graph %s ...\n", file);
+    bool read = false;
+    float tl = measureDuration([&]() { read = readMtxOmpW<true>(z, file); });
+    if (!read) { fprintf(stderr, "Cannot read graph %s\n", file); return 1; }
+    print(z); printf(" (readMtxOmpW, symmetricize: %.3f ms)\n", tl);
+    if (writeBin(cache, z, BIN_SYMMETRIC | BIN_SORTED, file)) printf("Saved graph cache %s\n", cache.c_str());
+  }
+  // Graph traits select specialized kernels (see copraDispatchTraits()).
+  bool unweighted = false, selfLoops = true;
+  float tt = measureDuration([&]() { unweighted = isUnweightedOmp(z); selfLoops = hasSelfLoopsOmp(z); });
+  printf("[%09.3f ms] graphTraits {unweighted=%d, selfLoops=%d}\n", tt, unweighted, selfLoops);
+  if (sweep) {
+    string graph = string(file);
+    graph = graph.substr(graph.find_last_of('/')+1);
+    graph = graph.substr(0, graph.rfind(".mtx"));
+    runSweep(z, graph, so, unweighted, selfLoops);
+  }
+  else runExperiment(z, repeat, cache, unweighted, selfLoops);
   printf("\n");
   return 0;
 }
@@ -0,0 +1,78 @@
+#include <utility>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <omp.h>
+#include "src/main.hxx"
+#include "src/copraCuda.hxx"
+
+using namespace std;
+
+
+
+
+// You can define datatype with -DTYPE=...
+#ifndef TYPE
+#define TYPE float
+#endif
+
+
+
+
+template <class G, class K, class W, class V>
+double getModularity(const G& x, const CopraResult<K, W>& a, V M) {
+  auto fc = [&](auto u) { return a.membership[u]; };
+  return modularityByOmp(x, fc, M, V(1));
+}
+
+
+template <class G, class V>
+void runCopraCuda(const G& x, V M, int repeat, float tolerance, int labels) {
+  using K = typename G::key_type;
+  vector<K> *init = nullptr;
+  for (bool sync : {false, true}) {
+    CopraOptions o(repeat, tolerance);
+    o.synchronous = sync; o.maxLabels = labels;
+    {
+      // Find COPRA using multiple threads, on the CPU.
+      auto ak = copraOmpStaticLabels(x, init, o);
+      printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraOmpStatic%s {labels=%02d, tolerance=%.0e}\n", ak.time, ak.iterations, getModularity(x, ak, M), sync? "Sync" : "", labels, tolerance);
+    }
+    {
+      // Find COPRA on the GPU.
+      auto ak = copraCudaLabels(x, init, o);
+      printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraCuda%s {labels=%02d, tolerance=%.0e, setup=%.3fms}\n", ak.time, ak.iterations, getModularity(x, ak, M), sync? "Sync" : "", labels, tolerance, ak.setupTime);
+    }
+  }
+}
+
+
+int main(int argc, char **argv) {
+  using K = int;
+  using V = TYPE;
+  char *file = argv[1];
+  int repeat = argc>2? stoi(argv[2]) : 5;
+  int device = 0;
+  cudaDeviceProp prop;
+  TRY_CUDA(cudaGetDevice(&device));
+  TRY_CUDA(cudaGetDeviceProperties(&prop, device));
+  printf("OMP_NUM_THREADS=%d CUDA device=%s\n", omp_get_max_threads(), prop.name);
+  DiGraphCsr<K, None, V> z;  // V w = 1;
+  string cache = string(file) + ".csr";
+  bool cached = false;
+  float tb = measureDuration([&]() { cached = readBinW(z, cache, BIN_SYMMETRIC | BIN_SORTED, file); });
+  if (cached) { print(z); printf(" (readBinW: %.3f ms)\n", tb); }
+  else {
+    printf("Loading graph %s ...\n", file);
+    bool read = false;
+    float tl = measureDuration([&]() { read = readMtxOmpW<true>(z, file); });
+    if (!read) { fprintf(stderr, "Cannot read graph %s\n", file); return 1; }
+    print(z); printf(" (readMtxOmpW, symmetricize: %.3f ms)\n", tl);
+    if (writeBin(cache, z, BIN_SYMMETRIC | BIN_SORTED, file)) printf("Saved graph cache %s\n", cache.c_str());
+  }
+  auto M = edgeWeight(z)/2;
+  for (int labels : {1, 4, 8})
+    runCopraCuda(z, M, repeat, 0.05f, labels);
+  printf("\n");
+  return 0;
+}
@@ -0,0 +1,18 @@
+#!/usr/bin/env bash
+src="copra-communities-seq"
+out="/home/resources/Documents/subhajit/$src-cuda.log"
+ulimit -s unlimited
+printf "" > "$out"
+
+# Download program
+rm -rf $src
+git clone https://github.com/puzzlef/$src
+cd $src
+
+# Run (CPU engines for comparison use all cores)
+nvcc -std=c++17 -O3 -Xcompiler -fopenmp mainCuda.cu -o a.cuda
+stdbuf --output=L ./a.cuda ~/data/soc-LiveJournal1.mtx  2>&1 | tee -a "$out"
+stdbuf --output=L ./a.cuda ~/data/italy_osm.mtx         2>&1 | tee -a "$out"
+stdbuf --output=L ./a.cuda ~/data/great-britain_osm.mtx 2>&1 | tee -a "$out"
+stdbuf --output=L ./a.cuda ~/data/germany_osm.mtx       2>&1 | tee -a "$out"
+stdbuf --output=L ./a.cuda ~/data/asia_osm.mtx          2>&1 | tee -a "$out"
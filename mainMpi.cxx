@@ -0,0 +1,75 @@
+#include <utility>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <mpi.h>
+#include "src/main.hxx"
+#include "src/copraMpi.hxx"
+
+using namespace std;
+
+
+
+
+// You can define datatype with -DTYPE=...
+#ifndef TYPE
+#define TYPE float
+#endif
+
+
+
+
+template <class S>
+void runCopraMpi(const S& s, int repeat, int rank, int ranks) {
+  for (int labels : {1, 4, 8}) {
+    for (bool sync : {false, true}) {
+      CopraOptions o(repeat, 0.05f);
+      o.synchronous = sync; o.maxLabels = labels; o.hashScan = true;
+      auto am = copraDispatchLabels(labels, [&](auto L) { return copraMpi<decltype(L)::value>(s, o); });
+      auto& st = am.stats;
+      if (rank!=0) continue;
+      printf("[%09.3f ms; %04d iters.; %01.9f modularity] copraMpi%s {labels=%02d, tolerance=%.0e} ranks=%d load=%.3f compute=%.3f exchange=%.3f ghosts=%zu boundary=%zu sent=%.3fMB rounds=%zu\n", am.result.time, am.result.iterations, am.modularity, sync? "Sync" : "", labels, o.tolerance, ranks, st.loadTime, st.computeTime, st.exchangeTime, st.ghosts, st.boundary, st.bytesSent / 1e6, st.rounds);
+    }
+  }
+}
+
+
+int main(int argc, char **argv) {
+  using K = int;
+  using V = TYPE;
+  int rank = 0, ranks = 1;
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+  char *file = argv[1];
+  int repeat = argc>2? stoi(argv[2]) : 5;
+  // Each rank reads only its own vertices from the binary snapshot, which the root writes if missing (or stale).
+  string cache = string(file) + ".csr";
+  if (rank==0) {
+    printf("MPI ranks=%d OMP_NUM_THREADS=%d\n", ranks, omp_get_max_threads());
+    BinStream<K, V, size_t> s(cache, BIN_SYMMETRIC | BIN_SORTED, file);
+    if (!s) {
+      DiGraphCsr<K, None, V> z;
+      printf("Loading graph %s ...\n", file);
+      bool read = false;
+      float tl = measureDuration([&]() { read = readMtxOmpW<true>(z, file); });
+      if (!read) {
+        fprintf(stderr, "Cannot read graph %s\n", file);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+      print(z); printf(" (readMtxOmpW, symmetricize: %.3f ms)\n", tl);
+      if (writeBin(cache, z, BIN_SYMMETRIC | BIN_SORTED, file)) printf("Saved graph cache %s\n", cache.c_str());
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  BinStream<K, V, size_t> s(cache, BIN_SYMMETRIC | BIN_SORTED, file);
+  if (!s) {
+    if (rank==0) fprintf(stderr, "Cannot read graph cache %s\n", cache.c_str());
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  if (rank==0) printf("order: %zu size: %zu (BinStream)\n", size_t(s.order()), s.size());
+  runCopraMpi(s, repeat, rank, ranks);
+  if (rank==0) printf("\n");
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,18 @@
+#!/usr/bin/env bash
+src="copra-communities-seq"
+out="/home/resources/Documents/subhajit/$src-mpi.log"
+ulimit -s unlimited
+printf "" > "$out"
+
+# Download program
+rm -rf $src
+git clone https://github.com/puzzlef/$src
+cd $src
+
+# Run (one rank per node, OpenMP threads within each node)
+mpicxx -std=c++17 -O3 -fopenmp mainMpi.cxx -o a.mpi
+for f in web-Stanford web-BerkStan web-Google web-NotreDame soc-Slashdot0811 soc-Slashdot0902 soc-Epinions1 coAuthorsDBLP coAuthorsCiteseer soc-LiveJournal1 coPapersCiteseer coPapersDBLP indochina-2004 italy_osm great-britain_osm germany_osm asia_osm; do
+  for np in 1 2 4 8 16; do
+    stdbuf --output=L mpirun -np $np --map-by ppr:1:node ./a.mpi ~/data/$f.mtx 2>&1 | tee -a "$out"
+  done
+done
@@ -79,6 +79,30 @@ function readLogLine(ln, data, state) {
   return state;
 }
 
+// Sweep results written by `--json=<file>` need no scraping.
+function readJson(pth) {
+  var rows = JSON.parse(readFile(pth));
+  var data = new Map();
+  for (var r of rows) {
+    if (!data.has(r.graph)) data.set(r.graph, []);
+    data.get(r.graph).push({
+      graph:       r.graph,
+      time:        r.time.median,
+      timeMin:     r.time.min,
+      timeStddev:  r.time.stddev,
+      setupTime:   r.setupTime.median,
+      iterationTime: r.iterationTime.median,
+      iterations:  r.iterations,
+      modularity:  r.modularity,
+      technique:   r.engine,
+      labels:      r.labels,
+      tolerance:   r.tolerance,
+      threads:     r.threads,
+    });
+  }
+  return data;
+}
+
 function readLog(pth) {
   var text  = readFile(pth);
   var lines = text.split('\n');
@@ -109,7 +133,7 @@ function processCsv(data) {
 // ----
 
 function main(cmd, log, out) {
-  var data = readLog(log);
+  var data = path.extname(log)==='.json'? readJson(log) : readLog(log);
   if (path.extname(out)==='') cmd += '-dir';
   switch (cmd) {
     case 'csv':
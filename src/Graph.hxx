@@ -1,12 +1,14 @@
 #pragma once
 #include <utility>
 #include <vector>
+#include <algorithm>
 #include <ostream>
 #include <iostream>
 #include "_main.hxx"
 
 using std::pair;
 using std::vector;
+using std::lower_bound;
 using std::ostream;
 using std::cout;
 
@@ -756,6 +758,272 @@ using ROrderedGraph  = Graph<K, V, E, ROrderedBitset>;
 
 
 
+// DI-GRAPH-CSR
+// ------------
+// Read-only directed graph stored in compressed sparse row (CSR) format.
+// Vertex keys are kept as is, so missing vertices just have no edges.
+
+template <class K=int, class V=NONE, class E=NONE, class O=size_t>
+class DiGraphCsr {
+  // Data.
+  public:
+  size_t N = 0;
+  vector<bool> vexists;
+  vector<V>    vvalues;
+  vector<O>    offsets;
+  vector<K>    ekeys;
+  vector<E>    evalues;
+
+  // Types.
+  public:
+  GRAPH_TYPES(K, V, E)
+  using offset_type = O;
+
+
+  // Property operations.
+  public:
+  GRAPH_SIZES(K, V, E, N, ekeys.size(), vexists)
+  GRAPH_DIRECTEDNESS(K, V, E, true)
+
+
+  // Scan operations.
+  public:
+  GRAPH_CVERTICES(K, V, E, vexists, vvalues)
+  inline auto cedgeKeys(const K& u) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    return iterable(ekeys.begin()+ib, ekeys.begin()+ie);
+  }
+  inline auto cedgeValues(const K& u) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    return iterable(evalues.begin()+ib, evalues.begin()+ie);
+  }
+  inline auto cedges(const K& u) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    return pair_iterable(ekeys.begin()+ib, ekeys.begin()+ie, evalues.begin()+ib, evalues.begin()+ie);
+  }
+  GRAPH_VERTICES(K, V, E)
+  GRAPH_EDGES(K, V, E)
+
+  public:
+  GRAPH_CFOREACH_VERTEX(K, V, E, vexists, vvalues)
+  template <class F>
+  inline void cforEachEdgeKey(const K& u, F fn) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    for (O i=ib; i<ie; ++i)
+      fn(ekeys[i]);
+  }
+  template <class F>
+  inline void cforEachEdgeValue(const K& u, F fn) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    for (O i=ib; i<ie; ++i)
+      fn(evalues[i]);
+  }
+  template <class F>
+  inline void cforEachEdge(const K& u, F fn) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    for (O i=ib; i<ie; ++i)
+      fn(ekeys[i], evalues[i]);
+  }
+  GRAPH_FOREACH_VERTEX(K, V, E)
+  GRAPH_FOREACH_EDGE(K, V, E)
+
+
+  // Access operations.
+  public:
+  GRAPH_BASE(K, V, E)
+  inline pair<O, O> edgeRange(const K& u) const noexcept {
+    if (u >= span()) return {O(), O()};
+    return {offsets[u], offsets[u+1]};
+  }
+  inline bool hasVertex(const K& u) const noexcept {
+    return u < span() && vexists[u];
+  }
+  inline bool hasEdge(const K& u, const K& v) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    auto it = lower_bound(ekeys.begin()+ib, ekeys.begin()+ie, v);
+    return it != ekeys.begin()+ie && *it == v;
+  }
+  inline K degree(const K& u) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    return K(ie - ib);
+  }
+  GRAPH_VERTEX_VALUE(K, V, E, vvalues)
+  inline E edgeValue(const K& u, const K& v) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    auto it = lower_bound(ekeys.begin()+ib, ekeys.begin()+ie, v);
+    if (it == ekeys.begin()+ie || *it != v) return E();
+    return evalues[it - ekeys.begin()];
+  }
+
+
+  // Update operations.
+  public:
+  inline bool resize(size_t n, size_t m) {
+    vexists.resize(n);
+    vvalues.resize(n);
+    offsets.resize(n+1);
+    ekeys.resize(m);
+    evalues.resize(m);
+    return true;
+  }
+  inline bool clear() noexcept {
+    if (empty() && offsets.empty()) return false;
+    N = 0;
+    vexists.clear();
+    vvalues.clear();
+    offsets.clear();
+    ekeys.clear();
+    evalues.clear();
+    return true;
+  }
+
+
+  // Lifetime operations.
+  public:
+  DiGraphCsr() {}
+  DiGraphCsr(size_t n, size_t m) { resize(n, m); }
+};
+
+
+
+
+// DI-GRAPH-CSR-SLACK
+// ------------------
+// Directed graph in CSR format, with spare capacity at the end of each row.
+// Rows are updated in place (see applyBatchUpdateSlackOmpU()), and a row that
+// outgrows its capacity is moved to the end of the edge arrays.
+
+template <class K=int, class V=NONE, class E=NONE, class O=size_t>
+class DiGraphCsrSlack {
+  // Data.
+  public:
+  size_t N = 0;
+  size_t M = 0;
+  vector<bool> vexists;
+  vector<V>    vvalues;
+  vector<O>    offsets;     // first edge of each row
+  vector<O>    degrees;     // edges in each row
+  vector<O>    capacities;  // edges each row can hold
+  vector<K>    ekeys;
+  vector<E>    evalues;
+
+  // Types.
+  public:
+  GRAPH_TYPES(K, V, E)
+  using offset_type = O;
+
+
+  // Property operations.
+  public:
+  GRAPH_SIZES(K, V, E, N, M, vexists)
+  GRAPH_DIRECTEDNESS(K, V, E, true)
+
+
+  // Scan operations.
+  public:
+  GRAPH_CVERTICES(K, V, E, vexists, vvalues)
+  inline auto cedgeKeys(const K& u) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    return iterable(ekeys.begin()+ib, ekeys.begin()+ie);
+  }
+  inline auto cedgeValues(const K& u) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    return iterable(evalues.begin()+ib, evalues.begin()+ie);
+  }
+  inline auto cedges(const K& u) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    return pair_iterable(ekeys.begin()+ib, ekeys.begin()+ie, evalues.begin()+ib, evalues.begin()+ie);
+  }
+  GRAPH_VERTICES(K, V, E)
+  GRAPH_EDGES(K, V, E)
+
+  public:
+  GRAPH_CFOREACH_VERTEX(K, V, E, vexists, vvalues)
+  template <class F>
+  inline void cforEachEdgeKey(const K& u, F fn) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    for (O i=ib; i<ie; ++i)
+      fn(ekeys[i]);
+  }
+  template <class F>
+  inline void cforEachEdgeValue(const K& u, F fn) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    for (O i=ib; i<ie; ++i)
+      fn(evalues[i]);
+  }
+  template <class F>
+  inline void cforEachEdge(const K& u, F fn) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    for (O i=ib; i<ie; ++i)
+      fn(ekeys[i], evalues[i]);
+  }
+  GRAPH_FOREACH_VERTEX(K, V, E)
+  GRAPH_FOREACH_EDGE(K, V, E)
+
+
+  // Access operations.
+  public:
+  GRAPH_BASE(K, V, E)
+  inline pair<O, O> edgeRange(const K& u) const noexcept {
+    if (u >= span()) return {O(), O()};
+    return {offsets[u], offsets[u] + degrees[u]};
+  }
+  inline bool hasVertex(const K& u) const noexcept {
+    return u < span() && vexists[u];
+  }
+  inline bool hasEdge(const K& u, const K& v) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    auto it = lower_bound(ekeys.begin()+ib, ekeys.begin()+ie, v);
+    return it != ekeys.begin()+ie && *it == v;
+  }
+  inline K degree(const K& u) const noexcept {
+    return u < span()? K(degrees[u]) : K();
+  }
+  GRAPH_VERTEX_VALUE(K, V, E, vvalues)
+  inline E edgeValue(const K& u, const K& v) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    auto it = lower_bound(ekeys.begin()+ib, ekeys.begin()+ie, v);
+    if (it == ekeys.begin()+ie || *it != v) return E();
+    return evalues[it - ekeys.begin()];
+  }
+
+
+  // Update operations.
+  public:
+  inline bool resize(size_t n, size_t m) {
+    vexists.resize(n);
+    vvalues.resize(n);
+    offsets.resize(n+1);
+    degrees.resize(n);
+    capacities.resize(n);
+    ekeys.resize(m);
+    evalues.resize(m);
+    return true;
+  }
+  inline bool clear() noexcept {
+    if (empty() && offsets.empty()) return false;
+    N = 0;
+    M = 0;
+    vexists.clear();
+    vvalues.clear();
+    offsets.clear();
+    degrees.clear();
+    capacities.clear();
+    ekeys.clear();
+    evalues.clear();
+    return true;
+  }
+
+
+  // Lifetime operations.
+  public:
+  DiGraphCsrSlack() {}
+  DiGraphCsrSlack(size_t n, size_t m) { resize(n, m); }
+};
+
+
+
+
 // GRAPH-VIEW
 // ----------
 
@@ -942,4 +1210,8 @@ GRAPH_WRITE(K, V, E, Bitset, DiGraph)
 GRAPH_WRITE(K, V, E, Bitset, OutDiGraph)
 GRAPH_WRITE(K, V, E, Bitset, Graph)
 GRAPH_WRITE_VIEW(G, GraphView)
+template <class K, class V, class E, class O>
+inline void write(ostream& a, const DiGraphCsr<K, V, E, O>& x, bool det=false) { writeGraph(a, x, det); }
+template <class K, class V, class E, class O>
+inline ostream& operator<<(ostream& a, const DiGraphCsr<K, V, E, O>& x) { write(a, x); return a; }
 GRAPH_WRITE_VIEW(G, TransposedGraphView)
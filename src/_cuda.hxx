@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <cuda_runtime.h>
+
+using std::vector;
+
+
+
+
+// TRY-CUDA
+// --------
+// Abort on CUDA errors, with the failing expression.
+
+#ifndef TRY_CUDA
+inline void tryCuda(cudaError_t err, const char *exp, const char *func, int line, const char *file) {
+  if (err==cudaSuccess) return;
+  fprintf(stderr, "%s: %s\n  in expression %s\n  at %s:%d in %s\n", cudaGetErrorName(err), cudaGetErrorString(err), exp, func, line, file);
+  exit(err);
+}
+#define TRY_CUDA(exp) tryCuda(exp, #exp, __func__, __LINE__, __FILE__)
+#endif
+
+
+
+
+// CUDA-MEMORY
+// -----------
+
+/**
+ * Allocate device memory for an array.
+ * @param n number of elements
+ * @returns device array (null if empty)
+ */
+template <class T>
+inline T* allocateCuda(size_t n) {
+  T *a = nullptr;
+  if (n>0) TRY_CUDA(cudaMalloc(&a, n * sizeof(T)));
+  return a;
+}
+
+
+/**
+ * Free device memory of an array.
+ * @param a device array (updated, to null)
+ */
+template <class T>
+inline void freeCuda(T*& a) {
+  if (a) TRY_CUDA(cudaFree(a));
+  a = nullptr;
+}
+
+
+/**
+ * Copy a vector to device memory.
+ * @param a device array (updated)
+ * @param x host vector
+ */
+template <class T>
+inline void copyToCuda(T *a, const vector<T>& x) {
+  if (!x.empty()) TRY_CUDA(cudaMemcpy(a, x.data(), x.size() * sizeof(T), cudaMemcpyHostToDevice));
+}
+
+
+/**
+ * Copy device memory to a vector.
+ * @param a host vector (updated, of the same size)
+ * @param x device array
+ */
+template <class T>
+inline void copyFromCuda(vector<T>& a, const T *x) {
+  if (!a.empty()) TRY_CUDA(cudaMemcpy(a.data(), x, a.size() * sizeof(T), cudaMemcpyDeviceToHost));
+}
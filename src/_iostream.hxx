@@ -8,6 +8,10 @@
 #include <ostream>
 #include <fstream>
 #include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 using std::pair;
 using std::array;
@@ -38,6 +42,56 @@ string readFileText(const char *pth) {
 
 
 
+// MAPPED-FILE
+// -----------
+// Read-only memory map of a file (empty if it cannot be mapped).
+
+class MappedFile {
+  // Data.
+  protected:
+  const char *x = nullptr;
+  size_t N = 0;
+
+  // Access operations.
+  public:
+  inline const char* data() const noexcept { return x; }
+  inline size_t size()      const noexcept { return N; }
+  inline explicit operator bool() const noexcept { return x!=nullptr; }
+
+  // Give advice about a range of the file (MADV_WILLNEED, MADV_DONTNEED), page aligned.
+  inline void advise(size_t i, size_t n, int advice) const noexcept {
+    if (!x || i>=N) return;
+    size_t P = sysconf(_SC_PAGESIZE);
+    size_t ib = i / P * P, ie = i+n<N? i+n : N;
+    madvise((void*) (x+ib), ie-ib, advice);
+  }
+
+  // Lifetime operations.
+  public:
+  MappedFile(const char *pth) {
+    int fd = open(pth, O_RDONLY);
+    if (fd<0) return;
+    struct stat st;
+    if (fstat(fd, &st)==0 && st.st_size>0) {
+      void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p!=MAP_FAILED) {
+        madvise(p, st.st_size, MADV_SEQUENTIAL);
+        x = (const char*) p;
+        N = st.st_size;
+      }
+    }
+    close(fd);
+  }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile() {
+    if (x) munmap((void*) x, N);
+  }
+};
+
+
+
+
 // WRITE
 // -----
 
@@ -13,9 +13,12 @@ using std::array;
 using std::vector;
 using std::map;
 using std::copy;
+using std::stable_sort;
+using std::inplace_merge;
 using std::swap;
 using std::move;
 using std::abs;
+using std::min;
 using std::max;
 using std::sqrt;
 
@@ -516,3 +519,65 @@ template <class T, class TA, class V>
 inline void multiplyValueOmp(const vector<T>& x, vector<TA>& a, size_t i, size_t N, const V& v) {
   multiplyValueOmp(x.data()+i, a.data()+i, N, v);
 }
+
+
+
+
+// STABLE-SORT
+// -----------
+// Each thread sorts a chunk, and chunks are then merged in pairs.
+
+template <class T, class FL>
+void stableSortOmpU(T *x, size_t N, FL fl) {
+  int H = omp_get_max_threads();
+  if (N<SIZE_MIN_OMPM || H<=1) { stable_sort(x, x+N, fl); return; }
+  vector<size_t> bs(H+1);
+  for (int t=0; t<=H; ++t)
+    bs[t] = N*t/H;
+  #pragma omp parallel for schedule(static, 1)
+  for (int t=0; t<H; ++t)
+    stable_sort(x+bs[t], x+bs[t+1], fl);
+  for (int s=1; s<H; s*=2) {
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int t=0; t<H-s; t+=2*s)
+      inplace_merge(x+bs[t], x+bs[t+s], x+bs[min(t+2*s, H)], fl);
+  }
+}
+template <class T, class FL>
+inline void stableSortOmpU(vector<T>& x, FL fl) {
+  stableSortOmpU(x.data(), x.size(), fl);
+}
+
+
+
+
+// UNIQUE
+// ------
+// Keep the first of adjacent equal values. Each thread counts the values it
+// keeps in its chunk, and then writes them at its offset.
+
+template <class T, class FE>
+void uniqueOmpW(vector<T>& a, const vector<T>& x, FE fe) {
+  size_t N = x.size();
+  int    H = N<SIZE_MIN_OMPM? 1 : omp_get_max_threads();
+  vector<size_t> bs(H+1), ns(H+1);
+  auto fk = [&](size_t i) { return i==0 || !fe(x[i-1], x[i]); };
+  for (int t=0; t<=H; ++t)
+    bs[t] = N*t/H;
+  #pragma omp parallel for schedule(static, 1) if(H>1)
+  for (int t=0; t<H; ++t) {
+    size_t n = 0;
+    for (size_t i=bs[t]; i<bs[t+1]; ++i)
+      if (fk(i)) ++n;
+    ns[t] = n;
+  }
+  ns[H] = 0;
+  exclusiveScanW(ns, ns);
+  a.resize(ns[H]);
+  #pragma omp parallel for schedule(static, 1) if(H>1)
+  for (int t=0; t<H; ++t) {
+    size_t j = ns[t];
+    for (size_t i=bs[t]; i<bs[t+1]; ++i)
+      if (fk(i)) a[j++] = x[i];
+  }
+}
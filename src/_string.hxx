@@ -23,3 +23,88 @@ size_t countLines(const char* x) {
 inline size_t countLines(const string& x) {
   return countLines(x.c_str());
 }
+
+
+
+
+// PARSE-NUMBER
+// ------------
+// For fast parsing of text (no locale, or overflow checks).
+
+/**
+ * Skip spaces, tabs, and carriage returns (not newlines).
+ * @param x start of text
+ * @param e end of text
+ * @returns first non-blank character
+ */
+inline const char* skipBlank(const char *x, const char *e) noexcept {
+  while (x<e && (*x==' ' || *x=='\t' || *x=='\r')) ++x;
+  return x;
+}
+
+
+/**
+ * Skip to the start of the next line.
+ * @param x start of text
+ * @param e end of text
+ * @returns character after next newline (or end)
+ */
+inline const char* skipLine(const char *x, const char *e) noexcept {
+  while (x<e && *x!='\n') ++x;
+  return x<e? x+1 : e;
+}
+
+
+/**
+ * Parse an unsigned integer.
+ * @param a parsed value (output)
+ * @param x start of text
+ * @param e end of text
+ * @returns character after the number (x, if no digits)
+ */
+inline const char* parseUnsignedW(size_t& a, const char *x, const char *e) noexcept {
+  a = 0;
+  for (; x<e && *x>='0' && *x<='9'; ++x)
+    a = a*10 + (*x-'0');
+  return x;
+}
+
+
+/**
+ * Parse a real number, with optional sign, fraction, and exponent.
+ * @param a parsed value (output)
+ * @param x start of text
+ * @param e end of text
+ * @returns character after the number (x, if no digits)
+ */
+inline const char* parseRealW(double& a, const char *x, const char *e) noexcept {
+  const char *x0 = x;
+  bool neg = false;
+  if (x<e && (*x=='-' || *x=='+')) neg = *(x++)=='-';
+  const char *xd = x;
+  double m = 0;
+  for (; x<e && *x>='0' && *x<='9'; ++x)
+    m = m*10 + (*x-'0');
+  if (x<e && *x=='.') {
+    double f = 0.1;
+    for (++x; x<e && *x>='0' && *x<='9'; ++x, f*=0.1)
+      m += (*x-'0') * f;
+  }
+  if (x==xd) { a = 0; return x0; }
+  if (x<e && (*x=='e' || *x=='E')) {
+    const char *xe = x++;
+    bool eneg = false; int p = 0;
+    if (x<e && (*x=='-' || *x=='+')) eneg = *(x++)=='-';
+    if (x<e && *x>='0' && *x<='9') {
+      for (; x<e && *x>='0' && *x<='9'; ++x)
+        p = p*10 + (*x-'0');
+      double b = 10, s = 1;
+      for (; p; p>>=1, b*=b)
+        if (p & 1) s *= b;
+      m = eneg? m/s : m*s;
+    }
+    else x = xe;
+  }
+  a = neg? -m : m;
+  return x;
+}
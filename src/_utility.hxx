@@ -5,6 +5,7 @@
 
 using std::pair;
 using std::chrono::microseconds;
+using std::chrono::nanoseconds;
 using std::chrono::high_resolution_clock;
 using std::chrono::duration_cast;
 
@@ -42,6 +43,11 @@ float durationMilliseconds(const T& start, const T& stop) {
   auto a = duration_cast<microseconds>(stop - start);
   return a.count()/1000.0f;
 }
+template <class D>
+inline double durationMilliseconds(const D& d) {
+  auto a = duration_cast<nanoseconds>(d);
+  return a.count()/1e6;
+}
 
 
 template <class F>
@@ -0,0 +1,424 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "_main.hxx"
+#include "Graph.hxx"
+
+using std::pair;
+using std::string;
+using std::vector;
+using std::ios;
+using std::ofstream;
+using std::is_same;
+using std::memcpy;
+using std::memcmp;
+using std::fill;
+
+
+
+
+// BIN-HEADER
+// ----------
+// Binary CSR snapshot of a graph, for fast reload.
+// Layout: header, vexists[S] (uint8), offsets[S+1], ekeys[M], evalues[M];
+// each section is padded to 8 bytes. The header records the size, and
+// modification time of the source file, so stale snapshots can be rebuilt.
+
+#define BIN_MAGIC   "CSRGRAPH"
+#define BIN_VERSION 2
+#define BIN_SYMMETRIC 1
+#define BIN_SORTED    2
+
+
+struct BinHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint32_t keyBytes;
+  uint32_t edgeValueBytes;
+  uint32_t offsetBytes;
+  uint32_t reserved;
+  uint64_t order;
+  uint64_t span;
+  uint64_t size;
+  uint64_t sourceBytes;  // size of source file (0 if unknown)
+  uint64_t sourceTime;   // modification time of source file, in ns (0 if unknown)
+};
+
+
+/**
+ * Get size of a section of binary snapshot, padded to 8 bytes.
+ * @param N size of section in bytes
+ * @returns padded size in bytes
+ */
+inline size_t binPadded(size_t N) {
+  return (N + 7) & ~size_t(7);
+}
+
+
+/**
+ * Make header for a binary snapshot of a graph.
+ * @param x original graph
+ * @param flags BIN_SYMMETRIC, BIN_SORTED
+ * @returns binary header
+ */
+template <class K, class V, class E, class O>
+inline BinHeader binHeader(const DiGraphCsr<K, V, E, O>& x, uint32_t flags) {
+  BinHeader h = {};
+  memcpy(h.magic, BIN_MAGIC, 8);
+  h.version  = BIN_VERSION;
+  h.flags    = flags;
+  h.keyBytes = sizeof(K);
+  h.edgeValueBytes = is_same<E, None>::value? 0 : sizeof(E);
+  h.offsetBytes    = sizeof(O);
+  h.order = x.order();
+  h.span  = x.span();
+  h.size  = x.size();
+  return h;
+}
+
+
+/**
+ * Check if a binary snapshot can be read into a graph type.
+ * @param h header of snapshot
+ * @param g header of graph type (see binHeader())
+ * @param flags required flags (BIN_SYMMETRIC, BIN_SORTED)
+ * @returns is it compatible?
+ */
+inline bool binCompatible(const BinHeader& h, const BinHeader& g, uint32_t flags) {
+  if (memcmp(h.magic, g.magic, 8)!=0 || h.version!=g.version) return false;
+  if ((h.flags & flags)!=flags) return false;
+  return h.keyBytes==g.keyBytes && h.edgeValueBytes==g.edgeValueBytes && h.offsetBytes==g.offsetBytes;
+}
+
+
+/**
+ * Record the size, and modification time of the source file of a binary snapshot.
+ * @param h header of snapshot (updated)
+ * @param src path to source file
+ * @returns true if source file was found
+ */
+inline bool binStampSource(BinHeader& h, const string& src) {
+  struct stat st;
+  if (stat(src.c_str(), &st)!=0) return false;
+  h.sourceBytes = uint64_t(st.st_size);
+  h.sourceTime  = uint64_t(st.st_mtim.tv_sec) * 1000000000ULL + uint64_t(st.st_mtim.tv_nsec);
+  return true;
+}
+
+
+/**
+ * Check if a binary snapshot is out of date with its source file.
+ * @param h header of snapshot
+ * @param src path to source file
+ * @returns did source file change since snapshot? (false if it is missing)
+ */
+inline bool binStale(const BinHeader& h, const string& src) {
+  BinHeader g = {};
+  if (!binStampSource(g, src)) return false;
+  return h.sourceBytes!=g.sourceBytes || h.sourceTime!=g.sourceTime;
+}
+
+
+// Byte offsets of sections of a binary snapshot.
+struct BinSections {
+  size_t vexists;
+  size_t offsets;
+  size_t ekeys;
+  size_t evalues;
+  size_t end;
+};
+
+
+/**
+ * Find byte offsets of sections of a binary snapshot.
+ * @param h header of snapshot
+ * @returns byte offset of each section, and end of file
+ */
+inline BinSections binSections(const BinHeader& h) {
+  size_t S = h.span, M = h.size;
+  BinSections a;
+  a.vexists = binPadded(sizeof(h));
+  a.offsets = a.vexists + binPadded(S);
+  a.ekeys   = a.offsets + binPadded((S+1) * h.offsetBytes);
+  a.evalues = a.ekeys   + binPadded(M * h.keyBytes);
+  a.end     = a.evalues + binPadded(M * h.edgeValueBytes);
+  return a;
+}
+
+
+
+
+// WRITE-BIN
+// ---------
+
+/**
+ * Write a binary snapshot of a graph.
+ * @param pth path to file
+ * @param x original graph
+ * @param flags BIN_SYMMETRIC, BIN_SORTED
+ * @param src path to source file, recorded to detect stale snapshots (optional)
+ * @returns true if written
+ */
+template <class K, class V, class E, class O>
+bool writeBin(const string& pth, const DiGraphCsr<K, V, E, O>& x, uint32_t flags=BIN_SYMMETRIC | BIN_SORTED, const string& src="") {
+  BinHeader h = binHeader(x, flags);
+  if (!src.empty()) binStampSource(h, src);
+  size_t S = h.span, M = h.size;
+  const char pad[8] = {};
+  auto fw = [&](ofstream& f, const void *p, size_t N) {
+    f.write((const char*) p, N);
+    f.write(pad, binPadded(N) - N);
+  };
+  ofstream f(pth, ios::binary);
+  if (!f) return false;
+  vector<uint8_t> vexists(S);
+  for (size_t u=0; u<S; ++u)
+    vexists[u] = x.vexists[u];
+  fw(f, &h, sizeof(h));
+  fw(f, vexists.data(),   S);
+  fw(f, x.offsets.data(), (S+1) * sizeof(O));
+  fw(f, x.ekeys.data(),   M * sizeof(K));
+  if (h.edgeValueBytes) fw(f, x.evalues.data(), M * sizeof(E));
+  f.close();
+  return bool(f);
+}
+
+
+
+
+// READ-BIN
+// --------
+
+/**
+ * Read a binary snapshot of a graph (memory-mapped, no parsing).
+ * @param a output graph (updated)
+ * @param pth path to file
+ * @param flags required flags (BIN_SYMMETRIC, BIN_SORTED)
+ * @param src path to source file, which must not have changed since snapshot (optional)
+ * @returns true if read (false if missing, incompatible, or stale)
+ */
+template <class K, class V, class E, class O>
+bool readBinW(DiGraphCsr<K, V, E, O>& a, const string& pth, uint32_t flags=BIN_SYMMETRIC | BIN_SORTED, const string& src="") {
+  a.clear();
+  MappedFile f(pth.c_str());
+  if (!f || f.size() < sizeof(BinHeader)) return false;
+  BinHeader h;
+  memcpy(&h, f.data(), sizeof(h));
+  if (!binCompatible(h, binHeader(a, flags), flags)) return false;
+  if (!src.empty() && binStale(h, src)) return false;
+  size_t S = h.span, M = h.size;
+  BinSections b = binSections(h);
+  if (f.size() < b.end) return false;
+  a.resize(S, M);
+  const char *x = f.data();
+  for (size_t u=0; u<S; ++u)
+    a.vexists[u] = x[b.vexists+u]!=0;
+  copyValuesOmpW(a.offsets.data(), (const O*) (x+b.offsets), S+1);
+  copyValuesOmpW(a.ekeys.data(),   (const K*) (x+b.ekeys), M);
+  if (h.edgeValueBytes) copyValuesOmpW(a.evalues.data(), (const E*) (x+b.evalues), M);
+  a.N = h.order;
+  return true;
+}
+
+
+
+
+// BIN-PARTITION
+// -------------
+// Vertices [begin, end) of a binary snapshot with their edges, read on demand.
+// It can be scanned like a CSR graph, with vertex ids of the whole graph.
+
+template <class K=int, class E=None, class O=size_t>
+class BinPartition {
+  // Data.
+  public:
+  size_t N = 0;   // order of whole graph
+  size_t S = 0;   // span of whole graph
+  K begin = K();  // first vertex
+  K end   = K();  // one past last vertex
+  vector<uint8_t> vexists;
+  vector<O> offsets;  // relative to first edge of partition
+  vector<K> ekeys;
+  vector<E> evalues;
+
+  // Types.
+  public:
+  using key_type = K;
+  using vertex_key_type = K;
+  using edge_key_type   = K;
+  using edge_value_type = E;
+  using offset_type     = O;
+
+
+  // Property operations.
+  public:
+  inline K span()  const noexcept { return K(S); }
+  inline K order() const noexcept { return K(N); }
+  inline size_t size()  const noexcept { return ekeys.size(); }
+  inline size_t bytes() const noexcept { return vexists.size() + offsets.size()*sizeof(O) + ekeys.size()*sizeof(K) + evalues.size()*sizeof(E); }
+
+
+  // Scan operations.
+  public:
+  template <class F>
+  inline void forEachVertexKey(F fn) const noexcept {
+    for (K u=begin; u<end; ++u)
+      if (vexists[u-begin]) fn(u);
+  }
+  template <class F>
+  inline void forEachEdgeKey(const K& u, F fn) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    for (O i=ib; i<ie; ++i)
+      fn(ekeys[i]);
+  }
+  template <class F>
+  inline void forEachEdge(const K& u, F fn) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    for (O i=ib; i<ie; ++i)
+      fn(ekeys[i], evalues[i]);
+  }
+
+
+  // Access operations.
+  public:
+  inline pair<O, O> edgeRange(const K& u) const noexcept {
+    if (u < begin || u >= end) return {O(), O()};
+    return {offsets[u-begin], offsets[u-begin+1]};
+  }
+  inline bool hasVertex(const K& u) const noexcept {
+    return u >= begin && u < end && vexists[u-begin];
+  }
+  inline K degree(const K& u) const noexcept {
+    auto [ib, ie] = edgeRange(u);
+    return K(ie - ib);
+  }
+};
+
+
+
+
+// BIN-STREAM
+// ----------
+// Partitions of a memory-mapped binary snapshot, for graphs which do not fit in memory.
+// Pages of a partition are dropped after it is read, so only its copy is resident.
+
+template <class K=int, class E=None, class O=size_t>
+class BinStream {
+  // Data.
+  protected:
+  MappedFile f;
+  BinHeader  h = {};
+  BinSections b = {};
+  bool valid = false;
+
+
+  // Property operations.
+  public:
+  inline explicit operator bool() const noexcept { return valid; }
+  inline const BinHeader& header() const noexcept { return h; }
+  inline K span()  const noexcept { return K(h.span); }
+  inline K order() const noexcept { return K(h.order); }
+  inline size_t size() const noexcept { return h.size; }
+
+
+  // Access operations.
+  public:
+  /**
+   * Get edge offset of a vertex.
+   * @param u given vertex (up to span)
+   * @returns offset of first edge of vertex u
+   */
+  inline O offset(K u) const noexcept {
+    O a; memcpy(&a, f.data() + b.offsets + u*sizeof(O), sizeof(O));
+    return a;
+  }
+
+  /**
+   * Split vertices into partitions of contiguous vertices, with a bounded number of edges.
+   * A vertex with more edges than the bound is in a partition of its own.
+   * @param M maximum number of edges in a partition
+   * @returns first vertex of each partition, followed by span
+   */
+  inline vector<K> partitions(size_t M) const {
+    vector<K> a;
+    K S = span();
+    M = M? M : 1;
+    for (K u=0; u<S;) {
+      a.push_back(u);
+      O ib = offset(u);
+      K v  = u+1;
+      while (v<S && size_t(offset(v+1) - ib) <= M) ++v;
+      u = v;
+    }
+    a.push_back(S);
+    // Offsets are read once, so their pages need not stay resident.
+    f.advise(b.offsets, (S+1) * sizeof(O), MADV_DONTNEED);
+    return a;
+  }
+
+  /**
+   * Read a partition of vertices.
+   * @param a partition (output)
+   * @param ub first vertex
+   * @param ue one past last vertex
+   */
+  inline void readPartitionW(BinPartition<K, E, O>& a, K ub, K ue) const {
+    const char *x = f.data();
+    size_t n = ue - ub;
+    a.N = h.order;
+    a.S = h.span;
+    a.begin = ub;
+    a.end   = ue;
+    a.vexists.resize(n);
+    a.offsets.resize(n+1);
+    O ib = offset(ub);
+    for (size_t i=0; i<=n; ++i)
+      a.offsets[i] = offset(K(ub+i)) - ib;
+    size_t m = a.offsets[n];
+    a.ekeys.resize(m);
+    a.evalues.resize(m);
+    memcpy(a.vexists.data(), x + b.vexists + ub, n);
+    memcpy(a.ekeys.data(), x + b.ekeys + ib*sizeof(K), m*sizeof(K));
+    if (h.edgeValueBytes) memcpy((void*) a.evalues.data(), x + b.evalues + ib*sizeof(E), m*sizeof(E));
+    else if constexpr (!is_same<E, None>::value) fill(a.evalues.begin(), a.evalues.end(), E(1));
+    f.advise(b.vexists + ub, n, MADV_DONTNEED);
+    f.advise(b.offsets + ub*sizeof(O), (n+1)*sizeof(O), MADV_DONTNEED);
+    f.advise(b.ekeys + ib*sizeof(K), m*sizeof(K), MADV_DONTNEED);
+    if (h.edgeValueBytes) f.advise(b.evalues + ib*sizeof(E), m*sizeof(E), MADV_DONTNEED);
+  }
+
+
+  // Lifetime operations.
+  public:
+  /**
+   * Open a binary snapshot for streaming.
+   * @param pth path to file
+   * @param flags required flags (BIN_SYMMETRIC, BIN_SORTED)
+   * @param src path to source file, which must not have changed since snapshot (optional)
+   */
+  BinStream(const string& pth, uint32_t flags=BIN_SYMMETRIC | BIN_SORTED, const string& src="") : f(pth.c_str()) {
+    if (!f || f.size() < sizeof(BinHeader)) return;
+    memcpy(&h, f.data(), sizeof(h));
+    BinHeader g = {};
+    memcpy(g.magic, BIN_MAGIC, 8);
+    g.version  = BIN_VERSION;
+    g.keyBytes = sizeof(K);
+    g.edgeValueBytes = is_same<E, None>::value? 0 : sizeof(E);
+    g.offsetBytes    = sizeof(O);
+    // Unweighted snapshots are read with unit edge weights.
+    if (h.edgeValueBytes==0) g.edgeValueBytes = 0;
+    if (!binCompatible(h, g, flags)) return;
+    if (!src.empty() && binStale(h, src)) return;
+    b = binSections(h);
+    valid = f.size() >= b.end;
+  }
+};
@@ -1,16 +1,47 @@
 #pragma once
+#include <cmath>
+#include <numeric>
+#include <cstdint>
 #include <limits>
+#include <type_traits>
 #include <utility>
+#include <algorithm>
+#include <array>
 #include <vector>
+#include <string>
+#include <ostream>
+#include <stdexcept>
 #include "_main.hxx"
+#if defined(COPRA_SCAN_SIMD) && (defined(__AVX2__) || defined(__AVX512F__))
+// Some GCC versions warn about undefined vectors in AVX-512 intrinsics.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#endif
 
 using std::pair;
 using std::tuple;
+using std::array;
 using std::vector;
+using std::ostream;
+using std::tuple_size;
+using std::is_same;
+using std::void_t;
+using std::declval;
+using std::true_type;
+using std::false_type;
+using std::is_floating_point;
+using std::integral_constant;
 using std::numeric_limits;
 using std::make_pair;
 using std::move;
 using std::get;
+using std::fill;
+using std::fabs;
+using std::gcd;
+using std::string;
+using std::invalid_argument;
 
 
 
@@ -22,32 +53,134 @@ using std::get;
 #define COPRA_MAX_MEMBERSHIP 8
 
 
+// Criterion for stopping iterations (see copraConverged()).
+enum class CopraConvergence {
+  LABEL,      // fraction of vertices whose best community changed is within tolerance
+  COUNT,      // number of communities, and minimum vertices per community, did not change (as in paper)
+  BELONGING   // mean change in belonging coefficients of vertices is within tolerance
+};
+
+
 struct CopraOptions {
   int   repeat;
   float tolerance;
   int   maxIterations;
+  bool  saveLabelsets = false;
+  bool  fullSort = false;
+  bool  synchronous = false;
+  bool  computeModularity = false;
+  int   maxLabels = 0;      // labels per vertex, chosen at runtime (0 = capacity of labelsets)
+  bool  hashScan  = false;  // scan into a table of O(degree) size, instead of a dense array
+  int   hubDegree = 0;      // split scans of vertices with a larger degree across threads (0 = never, at least COPRA_HUB_CHUNK)
+  CopraConvergence convergence = CopraConvergence::LABEL;
+  int   stableIterations = 0;  // skip vertices whose community set has not changed for this many iterations (0 = never, at most 127)
+  uint64_t seed = 0;           // seed for breaking ties between labels, per iteration (0 = same ties in every iteration)
+  bool  unweighted = false;  // all edge weights are 1 (edge weights are not read, vertex weights are degrees)
+  bool  selfLoops  = true;   // graph may have self-loops (if not, scans skip the check)
 
   CopraOptions(int repeat=1, float tolerance=0.05, int maxIterations=20) :
   repeat(repeat), tolerance(tolerance), maxIterations(maxIterations) {}
 };
 
 
+/**
+ * Get the belonging coefficient threshold, below which labels are dropped.
+ * @param o copra options
+ * @param L capacity of each labelset
+ * @returns 1/maxLabels, or 1/L if maxLabels is not set
+ */
+template <class V>
+inline V copraThreshold(const CopraOptions& o, size_t L) {
+  return V(1) / (o.maxLabels>0? size_t(o.maxLabels) : L);
+}
+
+
+/**
+ * Reject options not supported by worklist engines (asynchronous, with dense scans).
+ * @param o copra options
+ * @param fn name of engine
+ * @throws invalid_argument if synchronous, hashScan, computeModularity, or a convergence other than LABEL is set
+ */
+inline void copraCheckWorklistOptions(const CopraOptions& o, const char *fn) {
+  const char *e = o.synchronous? "synchronous" : o.hashScan? "hashScan" : o.computeModularity? "computeModularity" : o.convergence!=CopraConvergence::LABEL? "convergence" : nullptr;
+  if (e) throw invalid_argument(string(fn) + "(): " + e + " is not supported");
+}
+
+
+
+
+// COPRA-TRACE
+// -----------
+// Per-phase, and per-iteration measurements (only recorded when tracing).
+
+struct CopraIterationTrace {
+  size_t changed;     // vertices whose best community changed
+  size_t processed;   // vertices processed
+  size_t edges;       // edges scanned
+  float  scanTime;    // time spent scanning communities (ms, summed over threads)
+  float  sortTime;    // time spent sorting scanned communities (ms, summed over threads)
+  float  chooseTime;  // time spent choosing communities (ms, summed over threads)
+  float  time;        // duration of iteration (ms)
+};
+
+
+struct CopraTrace {
+  float vertexWeightsTime = 0;
+  float initializeTime    = 0;
+  float extractTime       = 0;
+  vector<CopraIterationTrace> iterations;
+};
+
+
+/**
+ * Write trace of a COPRA run as JSON.
+ * @param a output stream
+ * @param x copra trace
+ */
+inline void writeCopraTraceJson(ostream& a, const CopraTrace& x) {
+  a << "{\"vertexWeightsTime\":" << x.vertexWeightsTime;
+  a << ",\"initializeTime\":"   << x.initializeTime;
+  a << ",\"extractTime\":"      << x.extractTime;
+  a << ",\"iterations\":[";
+  for (size_t i=0; i<x.iterations.size(); ++i) {
+    const auto& t = x.iterations[i];
+    if (i>0) a << ",";
+    a << "{\"changed\":"     << t.changed;
+    a << ",\"processed\":"   << t.processed;
+    a << ",\"edges\":"       << t.edges;
+    a << ",\"scanTime\":"    << t.scanTime;
+    a << ",\"sortTime\":"    << t.sortTime;
+    a << ",\"chooseTime\":"  << t.chooseTime;
+    a << ",\"time\":"        << t.time << "}";
+  }
+  a << "]}";
+}
+
+
 
 
 // COPRA-RESULT
 // ------------
 
-template <class K>
+template <class K, class V=float>
 struct CopraResult {
   vector<K> membership;
+  vector<size_t>    labelsetOffsets;  // labels of u are in [labelsetOffsets[u], labelsetOffsets[u+1])
+  vector<pair<K, V>> labelsets;       // (community, belonging coefficient), only non-zero
   int   iterations;
   float time;
+  float setupTime = 0;    // time spent finding vertex weights, and initializing (included in time)
+  double modularity = 0;  // overlapping modularity of the community sets returned (only if computeModularity)
+  CopraTrace trace;       // only if traced
 
   CopraResult(vector<K>&& membership, int iterations=0, float time=0) :
-  membership(membership), iterations(iterations), time(time) {}
+  membership(move(membership)), iterations(iterations), time(time) {}
 
   CopraResult(vector<K>& membership, int iterations=0, float time=0) :
   membership(move(membership)), iterations(iterations), time(time) {}
+
+  CopraResult(vector<K>&& membership, vector<size_t>&& labelsetOffsets, vector<pair<K, V>>&& labelsets, int iterations=0, float time=0) :
+  membership(move(membership)), labelsetOffsets(move(labelsetOffsets)), labelsets(move(labelsets)), iterations(iterations), time(time) {}
 };
 
 
@@ -60,6 +193,498 @@ template <class K, class V, size_t L>
 using Labelset = array<pair<K, V>, L>;
 
 
+// Community sets of all vertices, as an array of labelsets (default).
+// Unused labels have a zero belonging coefficient.
+template <class K, class V, size_t L>
+using LabelsetVector = vector<Labelset<K, V, L>>;
+
+
+// Types of a table of community sets (LabelsetVector, CompactLabelsets).
+template <class M>
+using LabelsetOf = typename M::value_type;
+template <class M>
+using LabelsetKeyOf   = typename LabelsetOf<M>::value_type::first_type;
+template <class M>
+using LabelsetValueOf = typename LabelsetOf<M>::value_type::second_type;
+
+
+
+
+// COMPACT-LABELSETS
+// -----------------
+// Community sets of all vertices, as a structure of arrays.
+// Each vertex has a count of its labels, so scans do not need a sentinel.
+// Belonging coefficients can be stored in fixed-point (C = uint16_t).
+
+template <class K, class V, size_t L, class C=V>
+class CompactLabelsets {
+  static_assert(L <= 255, "CompactLabelsets supports at most 255 labels per vertex!");
+
+  // Data.
+  protected:
+  vector<K> ckeys;
+  vector<C> cvalues;
+  vector<uint8_t> counts;
+
+  // Types.
+  public:
+  using value_type = Labelset<K, V, L>;
+  protected:
+  using A = value_type;
+
+
+  // Coefficient operations.
+  public:
+  static inline C encode(V b) noexcept {
+    if constexpr (is_floating_point<C>::value) return C(b);
+    else return C(b * numeric_limits<C>::max() + V(0.5));
+  }
+  static inline V decode(C b) noexcept {
+    if constexpr (is_floating_point<C>::value) return V(b);
+    else return V(b) / numeric_limits<C>::max();
+  }
+
+
+  // Iterator, reference types.
+  public:
+  class Iterator {
+    const K *k;
+    const C *c;
+    public:
+    inline pair<K, V> operator*() const noexcept { return {*k, decode(*c)}; }
+    inline Iterator& operator++() noexcept { ++k; ++c; return *this; }
+    inline bool operator!=(const Iterator& o) const noexcept { return k != o.k; }
+    Iterator(const K *k, const C *c) : k(k), c(c) {}
+  };
+
+  class ConstRef {
+    protected:
+    const CompactLabelsets *x;
+    size_t u;
+    public:
+    inline size_t size()   const noexcept { return x->counts[u]; }
+    inline Iterator begin() const noexcept { return Iterator(x->ckeys.data() + u*L, x->cvalues.data() + u*L); }
+    inline Iterator end()   const noexcept { return Iterator(x->ckeys.data() + u*L + size(), x->cvalues.data() + u*L + size()); }
+    inline pair<K, V> operator[](size_t i) const noexcept {
+      if (i >= size()) return {K(), V()};
+      return {x->ckeys[u*L+i], decode(x->cvalues[u*L+i])};
+    }
+    inline operator A() const noexcept {
+      A a = {};
+      for (size_t i=0; i<size(); ++i)
+        a[i] = (*this)[i];
+      return a;
+    }
+    ConstRef(const CompactLabelsets *x, size_t u) : x(x), u(u) {}
+  };
+
+  class Ref : public ConstRef {
+    using ConstRef::x;
+    using ConstRef::u;
+    public:
+    inline Ref& operator=(const A& a) noexcept {
+      auto *y = const_cast<CompactLabelsets*>(x); size_t n = 0;
+      for (; n<L && a[n].second; ++n) {
+        y->ckeys[u*L+n]   = a[n].first;
+        y->cvalues[u*L+n] = encode(a[n].second);
+      }
+      y->counts[u] = uint8_t(n);
+      return *this;
+    }
+    inline Ref& operator=(const Ref& r) noexcept { return *this = A(r); }
+    Ref(CompactLabelsets *x, size_t u) : ConstRef(x, u) {}
+  };
+
+
+  // Access operations.
+  public:
+  inline size_t size()  const noexcept { return counts.size(); }
+  inline size_t bytes() const noexcept { return ckeys.size()*sizeof(K) + cvalues.size()*sizeof(C) + counts.size(); }
+  inline ConstRef operator[](size_t u) const noexcept { return ConstRef(this, u); }
+  inline Ref      operator[](size_t u)       noexcept { return Ref(this, u); }
+
+
+  // Update operations.
+  public:
+  inline void resize(size_t S) {
+    ckeys.resize(S*L);
+    cvalues.resize(S*L);
+    counts.resize(S);
+  }
+
+
+  // Lifetime operations.
+  public:
+  CompactLabelsets() {}
+  CompactLabelsets(size_t S) { resize(S); }
+};
+
+
+// Compact community sets, with 16-bit fixed-point belonging coefficients.
+template <class K, class V, size_t L>
+using QuantizedLabelsets = CompactLabelsets<K, V, L, uint16_t>;
+
+
+/**
+ * Find the memory used by community sets of all vertices.
+ * @param vcom community set each vertex belongs to
+ * @returns size in bytes
+ */
+template <class K, class V, size_t L>
+inline size_t copraLabelsetsBytes(const LabelsetVector<K, V, L>& vcom) {
+  return vcom.size() * sizeof(Labelset<K, V, L>);
+}
+template <class K, class V, size_t L, class C>
+inline size_t copraLabelsetsBytes(const CompactLabelsets<K, V, L, C>& vcom) {
+  return vcom.bytes();
+}
+
+
+
+
+// COPRA-DISPATCH-LABELS
+// ---------------------
+// Labels per vertex chosen at runtime (CopraOptions::maxLabels), without an
+// instance of each kernel per label count. Common counts (1, 2, 4, 8) have
+// their own kernel, with labelsets of exactly that capacity. Any other count
+// uses a generic kernel with a larger capacity (16, or 32), where the number
+// of labels is bounded by the belonging threshold 1/maxLabels instead.
+
+// Maximum capacity of labelsets in the generic kernel.
+#define COPRA_MAX_DISPATCH_LABELS 32
+
+
+/**
+ * Get the capacity of labelsets used for a runtime label count.
+ * @param maxLabels labels per vertex
+ * @returns capacity of each labelset (at most COPRA_MAX_DISPATCH_LABELS)
+ */
+inline size_t copraDispatchCapacity(size_t maxLabels) {
+  if (maxLabels<=1) return 1;
+  if (maxLabels<=2) return 2;
+  if (maxLabels<=8) return maxLabels<=4? 4 : 8;
+  return maxLabels<=16? 16 : COPRA_MAX_DISPATCH_LABELS;
+}
+
+
+/**
+ * Call a function with the capacity of labelsets for a runtime label count.
+ * @param maxLabels labels per vertex
+ * @param fn called with capacity, as a compile-time constant (integral_constant<size_t, L>)
+ * @returns result of fn
+ */
+template <class F>
+inline auto copraDispatchLabels(size_t maxLabels, F fn) {
+  switch (copraDispatchCapacity(maxLabels)) {
+    case 1:  return fn(integral_constant<size_t, 1>());
+    case 2:  return fn(integral_constant<size_t, 2>());
+    case 4:  return fn(integral_constant<size_t, 4>());
+    case 8:  return fn(integral_constant<size_t, 8>());
+    case 16: return fn(integral_constant<size_t, 16>());
+    default: return fn(integral_constant<size_t, COPRA_MAX_DISPATCH_LABELS>());
+  }
+}
+
+
+
+
+// COPRA-DISPATCH-TRAITS
+// ---------------------
+// Graph traits found once at load time (see isUnweighted(), hasSelfLoops())
+// select kernels that do not read edge weights, or check for self-loops
+// (only the default kernel, without fullSort, to bound
+// the number of instantiations).
+// They must be checked again if the graph is updated.
+
+/**
+ * Call a function with graph traits from copra options, as compile-time constants.
+ * @param o copra options (unweighted, selfLoops)
+ * @param fn called with (unweighted?, no self-loops?), each an integral_constant<bool, B>
+ * @returns result of fn
+ */
+template <class F>
+inline auto copraDispatchTraits(const CopraOptions& o, F fn) {
+  using T = integral_constant<bool, true>;
+  using U = integral_constant<bool, false>;
+  if (o.unweighted) return o.selfLoops? fn(T(), U()) : fn(T(), T());
+  return o.selfLoops? fn(U(), U()) : fn(U(), T());
+}
+
+
+
+
+// COPRA-SCAN-TABLE
+// ----------------
+// Sparse accumulator of the scan of a vertex, in place of a dense array of
+// size S. It holds at most n labels, for a given upper bound n (degree * L).
+// Small scans are kept as a linear list, and are searched linearly. Larger
+// scans use an open-addressing hash table (linear probing), of a power-of-two
+// capacity at least twice n. Its memory is O(max degree * L), so the tables of
+// all threads remain small, and written slots stay close together.
+
+// Maximum number of labels, for which the scan is kept as a linear list.
+#define COPRA_SCAN_TABLE_LINEAR 16
+
+template <class K, class V>
+class CopraScanTable {
+  // Data.
+  protected:
+  static constexpr K EMPTY = numeric_limits<K>::max();
+  vector<K> keys;
+  vector<V> values;
+  vector<size_t> slots;  // occupied slots (if hashed)
+  size_t count = 0;      // number of labels (if linear)
+  size_t mask  = 0;      // capacity - 1 (if hashed)
+  int    shift = 64;     // hash shift, for capacity (if hashed)
+  bool   hashed = false;
+
+
+  // Hash operations.
+  protected:
+  inline size_t slot(K c) const noexcept {
+    return size_t((uint64_t(c) * 0x9e3779b97f4a7c15ULL) >> shift);
+  }
+
+
+  // Access operations.
+  public:
+  inline size_t size() const noexcept { return hashed? slots.size() : count; }
+  inline size_t capacity() const noexcept { return keys.size(); }
+
+  inline V operator[](K c) const noexcept {
+    if (!hashed) {
+      for (size_t i=0; i<count; ++i)
+        if (keys[i]==c) return values[i];
+      return V();
+    }
+    for (size_t i=slot(c); keys[i]!=EMPTY; i=(i+1) & mask)
+      if (keys[i]==c) return values[i];
+    return V();
+  }
+
+  inline V& operator[](K c) noexcept {
+    if (!hashed) {
+      for (size_t i=0; i<count; ++i)
+        if (keys[i]==c) return values[i];
+      keys[count] = c; values[count] = V();
+      return values[count++];
+    }
+    size_t i = slot(c);
+    for (; keys[i]!=EMPTY; i=(i+1) & mask)
+      if (keys[i]==c) return values[i];
+    keys[i] = c; values[i] = V();
+    slots.push_back(i);
+    return values[i];
+  }
+
+
+  // Update operations.
+  public:
+  /**
+   * Prepare an empty table for at most n labels.
+   * @param n maximum number of labels to be scanned
+   */
+  inline void reserve(size_t n) {
+    size_t C = n;
+    hashed = n > COPRA_SCAN_TABLE_LINEAR;
+    if (hashed) {
+      int bits = 5;
+      for (; (size_t(1) << bits) < 2*n; ++bits);
+      C = size_t(1) << bits;
+      mask  = C-1;
+      shift = 64 - bits;
+    }
+    if (keys.size() < C) {
+      keys.resize(C, EMPTY);
+      values.resize(C);
+    }
+  }
+
+  /**
+   * Remove all labels, by resetting only the slots used.
+   */
+  inline void clear() noexcept {
+    if (!hashed) {
+      for (size_t i=0; i<count; ++i)
+        keys[i] = EMPTY;
+      count = 0;
+      return;
+    }
+    for (size_t i : slots)
+      keys[i] = EMPTY;
+    slots.clear();
+  }
+
+
+  // Lifetime operations.
+  public:
+  CopraScanTable() {}
+};
+
+
+
+
+// COPRA-WORKSPACE
+// ---------------
+// Buffers reused across COPRA runs, and batch updates.
+// Buffers are only (re)allocated when the graph span, or thread count grows,
+// and scan buffers are reset sparsely (see copraClearScan).
+// After a run, vcom and vtot hold the result, and vertex weights of its graph.
+// A dynamic run on the next graph can resume from them in place, by passing
+// q = &vcom (each repeat then continues from where the last one stopped).
+
+template <class K, class V, class M>
+class CopraWorkspace {
+  // Data.
+  public:
+  vector<K>  vcs;    // communities vertex u is linked to
+  vector<V>  vcout;  // total edge weight from vertex u to community C
+  vector<V>  vtot;   // total edge weight of each vertex
+  vector<V>  vctot;  // total edge weight of each community (modularity)
+  M vcom;            // community set each vertex belongs to
+  M vcon;            // community set each vertex belongs to, after an iteration (synchronous)
+  vector<char> vaff;         // is vertex affected? (not vector<bool>, as it is written concurrently)
+  vector<char> vneighbors;   // are neighbors of vertex affected? (delta-screening)
+  vector<char> vcommunities; // is community affected? (delta-screening)
+  vector<K>  vhubs;          // vertices whose scans are split across threads
+  vector<K>  vccount;        // number of vertices in each community (convergence by count)
+  vector<char> vstable;      // iterations for which community set of each vertex has not changed
+  vector<vector<K>*> tvcs;   // vcs of each thread
+  vector<vector<V>*> tvcout; // vcout of each thread
+  vector<K>  vtcs;                       // vcs of hash scan (kept apart, so dense vcout is always cleared by vcs)
+  CopraScanTable<K, V> vtab;             // sparse vcout (hash scan)
+  vector<vector<K>*> tvtcs;              // vtcs of each thread
+  vector<CopraScanTable<K, V>*> tvtab;   // vtab of each thread
+  vector<vector<pair<K, V>>*> tvhs;           // labels scanned from each chunk of hub edges, by each thread
+  vector<CopraScanTable<K, double>*> tvht;    // merged labels of a hub, for each thread
+  vector<K>  vq;             // vertices to process in this iteration (worklist)
+  vector<K>  vqn;            // vertices to process in the next iteration (worklist)
+  vector<char> vnext;        // is vertex in next worklist?
+  vector<vector<K>*> tvqn;   // vqn of each thread
+  bool freshWeights = false; // is vtot up to date for the next run? (then it is not recomputed, or updated by dynamic approaches)
+  const vector<V> *sharedWeights = nullptr; // vertex weights shared by other workspaces, read instead of vtot (static approaches only)
+
+  // Types.
+  public:
+  using key_type   = K;
+  using value_type = V;
+  using labelsets_type = M;
+
+
+  // Update operations.
+  public:
+  inline void resizeScans(size_t S, bool dense=true) {
+    if (!dense || vcout.size()==S) return;
+    vcs.clear();
+    vcout.assign(S, V());
+  }
+
+  inline void resizeThreadScans(size_t S, size_t T, bool dense=true) {
+    // Dense scans are left empty, if only hash scans are used.
+    if (tvcs.size()!=T || (T>0 && dense && tvcout[0]->size()!=S)) {
+      clearThreadScans();
+      tvcs.resize(T);
+      tvcout.resize(T);
+      for (size_t t=0; t<T; ++t) {
+        tvcs[t]   = new vector<K>();
+        tvcout[t] = new vector<V>(dense? S : 0);
+      }
+    }
+    if (dense || tvtab.size()==T) return;
+    tvtcs.resize(T);
+    tvtab.resize(T);
+    for (size_t t=0; t<T; ++t) {
+      tvtcs[t] = new vector<K>();
+      tvtab[t] = new CopraScanTable<K, V>();
+    }
+  }
+
+  inline void resizeHubScans(size_t T) {
+    if (tvhs.size()==T) return;
+    clearHubScans();
+    tvhs.resize(T);
+    tvht.resize(T);
+    for (size_t t=0; t<T; ++t) {
+      tvhs[t] = new vector<pair<K, V>>();
+      tvht[t] = new CopraScanTable<K, double>();
+    }
+  }
+
+  inline void resizeWorklist(size_t S, size_t T=0) {
+    vnext.resize(S);
+    if (tvqn.size()==T) return;
+    clearWorklist();
+    tvqn.resize(T);
+    for (size_t t=0; t<T; ++t)
+      tvqn[t] = new vector<K>();
+  }
+
+  inline void resizeLabelsets(size_t S, bool synchronous=false) {
+    if (!sharedWeights) vtot.resize(S);
+    if (vcom.size()!=S) vcom = M(S);
+    if (synchronous && vcon.size()!=S) vcon = M(S);
+  }
+
+  inline bool ownsLabelsets(const void *q) const noexcept {
+    return q==&vcom;
+  }
+
+  inline void resizeCommunityWeights(size_t S) {
+    vctot.resize(S);
+  }
+
+  inline void resizeConvergence(size_t S, bool count, bool stable) {
+    if (count)  vccount.resize(S);
+    if (stable) vstable.resize(S);
+  }
+
+  inline void resizeFlags(size_t S, bool deltaScreening=false) {
+    vaff.resize(S);
+    if (!deltaScreening) return;
+    vneighbors.resize(S);
+    vcommunities.resize(S);
+  }
+
+  inline void clearThreadScans() {
+    for (size_t t=0; t<tvcs.size(); ++t) {
+      delete tvcs[t];
+      delete tvcout[t];
+    }
+    for (size_t t=0; t<tvtab.size(); ++t) {
+      delete tvtcs[t];
+      delete tvtab[t];
+    }
+    tvcs.clear();
+    tvcout.clear();
+    tvtcs.clear();
+    tvtab.clear();
+  }
+
+  inline void clearWorklist() {
+    for (size_t t=0; t<tvqn.size(); ++t)
+      delete tvqn[t];
+    tvqn.clear();
+  }
+
+  inline void clearHubScans() {
+    for (size_t t=0; t<tvhs.size(); ++t) {
+      delete tvhs[t];
+      delete tvht[t];
+    }
+    tvhs.clear();
+    tvht.clear();
+  }
+
+
+  // Lifetime operations.
+  public:
+  CopraWorkspace() {}
+  CopraWorkspace(const CopraWorkspace&) = delete;
+  CopraWorkspace& operator=(const CopraWorkspace&) = delete;
+  ~CopraWorkspace() { clearThreadScans(); clearHubScans(); clearWorklist(); }
+};
+
+
 
 
 // COPRA-INITIALIZE
@@ -67,28 +692,375 @@ using Labelset = array<pair<K, V>, L>;
 
 /**
  * Find the total edge weight of each vertex.
+ * @tparam UNWEIGHTED are all edge weights 1 (vertex weight is degree)?
  * @param vtot total edge weight of each vertex (updated)
  * @param x original graph
  */
-template <class G, class V>
+template <bool UNWEIGHTED=false, class G, class V>
 void copraVertexWeights(vector<V>& vtot, const G& x) {
   x.forEachVertexKey([&](auto u) {
+    if constexpr (UNWEIGHTED) { vtot[u] = V(x.degree(u)); return; }
     vtot[u] = V();
     x.forEachEdge(u, [&](auto v, auto w) { vtot[u] += w; });
   });
 }
 
+template <bool UNWEIGHTED=false, class G, class V>
+void copraVertexWeightsOmp(vector<V>& vtot, const G& x) {
+  using K = typename G::key_type;
+  K S = x.span();
+  #pragma omp parallel for schedule(auto)
+  for (K u=0; u<S; ++u) {
+    if (!x.hasVertex(u)) continue;
+    if constexpr (UNWEIGHTED) { vtot[u] = V(x.degree(u)); continue; }
+    vtot[u] = V();
+    x.forEachEdge(u, [&](auto v, auto w) { vtot[u] += w; });
+  }
+}
+
+
+/**
+ * Update total edge weight of vertices touched by a batch update.
+ * @param vtot total edge weight of each vertex (updated)
+ * @param x updated graph
+ * @param deletions edge deletions in this batch update (undirected, sorted by source vertex id)
+ * @param insertions edge insertions in this batch update (undirected, sorted by source vertex id)
+ */
+template <class G, class K, class V>
+void copraUpdateVertexWeightsW(vector<V>& vtot, const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions) {
+  auto fv = [&](K u) {
+    vtot[u] = V();
+    x.forEachEdge(u, [&](auto v, auto w) { vtot[u] += w; });
+  };
+  for (size_t i=0, I=deletions.size(); i<I; ++i) {
+    K u = get<0>(deletions[i]);
+    if (i==0 || get<0>(deletions[i-1])!=u) fv(u);
+  }
+  for (size_t i=0, I=insertions.size(); i<I; ++i) {
+    K u = get<0>(insertions[i]);
+    if (i==0 || get<0>(insertions[i-1])!=u) fv(u);
+  }
+}
+
+template <class G, class K, class V>
+void copraUpdateVertexWeightsOmpW(vector<V>& vtot, const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions) {
+  auto fv = [&](K u) {
+    V a = V();
+    x.forEachEdge(u, [&](auto v, auto w) { a += w; });
+    vtot[u] = a;
+  };
+  size_t D = deletions.size(), I = insertions.size();
+  #pragma omp parallel for schedule(auto)
+  for (size_t i=0; i<D; ++i) {
+    K u = get<0>(deletions[i]);
+    if (i==0 || get<0>(deletions[i-1])!=u) fv(u);
+  }
+  #pragma omp parallel for schedule(auto)
+  for (size_t i=0; i<I; ++i) {
+    K u = get<0>(insertions[i]);
+    if (i==0 || get<0>(insertions[i-1])!=u) fv(u);
+  }
+}
+
 
 /**
  * Initialize communities such that each vertex is its own community.
  * @param vcom community set each vertex belongs to (updated)
  * @param x original graph
  */
-template <class G, class K, class V, size_t L>
-inline void copraInitialize(vector<Labelset<K, V, L>>& vcom, const G& x) {
+template <class G, class M>
+inline void copraInitialize(M& vcom, const G& x) {
+  using V = LabelsetValueOf<M>;
   x.forEachVertexKey([&](auto u) { vcom[u] = {make_pair(u, V(1))}; });
 }
 
+template <class G, class M>
+inline void copraInitializeOmp(M& vcom, const G& x) {
+  using K = typename G::key_type;
+  using V = LabelsetValueOf<M>;
+  K S = x.span();
+  #pragma omp parallel for schedule(auto)
+  for (K u=0; u<S; ++u) {
+    if (!x.hasVertex(u)) continue;
+    vcom[u] = {make_pair(u, V(1))};
+  }
+}
+
+
+/**
+ * Initialize communities from a previous best community of each vertex.
+ * @param vcom community set each vertex belongs to (updated)
+ * @param x original graph
+ * @param q initial community each vertex belongs to
+ */
+template <class G, class M, class K>
+inline void copraInitializeFromMembership(M& vcom, const G& x, const vector<K>& q) {
+  using V = LabelsetValueOf<M>;
+  K Q = q.size();
+  x.forEachVertexKey([&](auto u) { vcom[u] = {make_pair(u<Q? q[u] : u, V(1))}; });
+}
+
+template <class G, class M, class K>
+inline void copraInitializeFromMembershipOmp(M& vcom, const G& x, const vector<K>& q) {
+  using V = LabelsetValueOf<M>;
+  K S = x.span();
+  K Q = q.size();
+  #pragma omp parallel for schedule(auto)
+  for (K u=0; u<S; ++u) {
+    if (!x.hasVertex(u)) continue;
+    vcom[u] = {make_pair(u<Q? q[u] : u, V(1))};
+  }
+}
+
+
+/**
+ * Mix bits of a 64-bit integer (splitmix64 finalizer).
+ * @param h given integer
+ * @returns mixed integer
+ */
+inline uint64_t copraMix64(uint64_t h) {
+  h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+  return h ^ (h >> 31);
+}
+
+
+/**
+ * Find a seeded relabeling of communities, as an affine bijection on [0, S).
+ * @param S span of vertices
+ * @param seed seed (0 = identity)
+ * @returns [multiplier, offset], coprime multiplier with S
+ */
+inline pair<uint64_t, uint64_t> copraSeedLabels(uint64_t S, uint64_t seed) {
+  if (seed==0 || S<=1) return {1, 0};
+  uint64_t a = copraMix64(seed) % S | 1;
+  uint64_t b = copraMix64(copraMix64(seed)) % S;
+  while (gcd(a, S)!=1) ++a;
+  return {a, b};
+}
+
+
+/**
+ * Initialize communities such that each vertex is its own community, with a seeded community id.
+ * Different seeds break ties between equal labels differently (see copraTieKey()).
+ * @param vcom community set each vertex belongs to (updated)
+ * @param x original graph
+ * @param seed seed (0 = same as copraInitialize())
+ */
+template <class G, class M>
+inline void copraInitializeSeeded(M& vcom, const G& x, uint64_t seed) {
+  using K = typename G::key_type;
+  using V = LabelsetValueOf<M>;
+  auto [a, b] = copraSeedLabels(x.span(), seed);
+  x.forEachVertexKey([&](auto u) { vcom[u] = {make_pair(K((a*u + b) % x.span()), V(1))}; });
+}
+
+
+/**
+ * Initialize communities from a previous community set of each vertex.
+ * @param vcom community set each vertex belongs to (updated)
+ * @param x original graph
+ * @param q initial community set each vertex belongs to
+ */
+template <class G, class M, class N>
+inline void copraInitializeFromLabelsets(M& vcom, const G& x, const N& q) {
+  using K = typename G::key_type;
+  using V = LabelsetValueOf<M>;
+  K Q = q.size();
+  x.forEachVertexKey([&](auto u) {
+    if (u<Q && q[u][0].second) vcom[u] = q[u];
+    else vcom[u] = {make_pair(u, V(1))};
+  });
+}
+
+template <class G, class M, class N>
+inline void copraInitializeFromLabelsetsOmp(M& vcom, const G& x, const N& q) {
+  using K = typename G::key_type;
+  using V = LabelsetValueOf<M>;
+  K S = x.span();
+  K Q = q.size();
+  #pragma omp parallel for schedule(auto)
+  for (K u=0; u<S; ++u) {
+    if (!x.hasVertex(u)) continue;
+    if (u<Q && q[u][0].second) vcom[u] = q[u];
+    else vcom[u] = {make_pair(u, V(1))};
+  }
+}
+
+
+/**
+ * Initialize communities from a previous community, or community set of each vertex.
+ * @param vcom community set each vertex belongs to (updated)
+ * @param x original graph
+ * @param q initial community (vector<K>), or community set of each vertex
+ */
+template <class G, class M, class Q>
+inline void copraInitializeFrom(M& vcom, const G& x, const Q& q) {
+  using K = typename G::key_type;
+  if constexpr (is_same<Q, vector<K>>::value) copraInitializeFromMembership(vcom, x, q);
+  else copraInitializeFromLabelsets(vcom, x, q);
+}
+
+template <class G, class M, class Q>
+inline void copraInitializeFromOmp(M& vcom, const G& x, const Q& q) {
+  using K = typename G::key_type;
+  if constexpr (is_same<Q, vector<K>>::value) copraInitializeFromMembershipOmp(vcom, x, q);
+  else copraInitializeFromLabelsetsOmp(vcom, x, q);
+}
+
+
+
+
+// COPRA-SCAN-SIMD
+// ---------------
+// Scan of a CSR row with one or two labels per vertex, for 16 edges (AVX-512),
+// or 8 edges (AVX2) at a time. Labels and belonging coefficients of neighbors are
+// gathered, and multiplied by edge weights. With AVX-512, repeated labels in a
+// step are found with conflict detection, and added in rounds of distinct
+// labels, with a gather and a scatter each. Each label then gets its weights in
+// edge order, so results are the same as with copraScanCommunity(). Define
+// COPRA_SCAN_SIMD and build with -march=native (or -mavx512f -mavx512cd, or
+// -mavx2) to enable them. Otherwise a scalar loop over the row is used, which
+// was faster on our graphs (mean degree ~16), as gathers of random neighbors
+// are no faster than scalar loads.
+
+// Rows of a graph, with contiguous edge keys and values (DiGraphCsr, BinPartition).
+template <class G, class=void>
+struct CopraCsrRows : false_type {};
+template <class G>
+struct CopraCsrRows<G, void_t<decltype(declval<const G&>().ekeys.data()), decltype(declval<const G&>().edgeRange(declval<typename G::key_type>()))>> : true_type {};
+
+
+/**
+ * Check if scans of a graph can use copraScanRowW().
+ * @tparam G graph type
+ * @tparam C scan accumulator type
+ * @tparam M community sets type
+ * @returns 32-bit keys, float values, dense scan accumulator, LabelsetVector with at most 2 labels, and CSR rows?
+ */
+template <class G, class C, class M>
+constexpr bool copraScanRows() {
+  using K = typename G::key_type;
+  using E = typename G::edge_value_type;
+  using V = LabelsetValueOf<M>;
+  constexpr size_t L = tuple_size<LabelsetOf<M>>::value;
+  if constexpr (!CopraCsrRows<G>::value) return false;
+  else return L<=2 && is_same<K, int>::value && is_same<V, float>::value && (is_same<E, float>::value || is_same<E, None>::value)
+    && is_same<C, vector<V>>::value && is_same<M, LabelsetVector<K, V, L>>::value;
+}
+
+
+/**
+ * Scan communities connected to a vertex, from its CSR row.
+ * @tparam SELF include self-loops?
+ * @tparam UNWEIGHTED are all edge weights 1?
+ * @param vcs communities vertex u is linked to (updated)
+ * @param vcout total edge weight from vertex u to community C (updated)
+ * @param u given vertex
+ * @param xek edge keys of graph
+ * @param xev edge values of graph (unused, if UNWEIGHTED)
+ * @param ib begin of row of vertex u
+ * @param ie end of row of vertex u
+ * @param vcom community set each vertex belongs to
+ */
+template <bool SELF=false, bool UNWEIGHTED=false, size_t L, class E, class O>
+inline void copraScanRowW(vector<int>& vcs, vector<float>& vcout, int u, const int *xek, const E *xev, O ib, O ie, const Labelset<int, float, L> *vcom) {
+  static_assert(sizeof(Labelset<int, float, L>) == 8*L, "Labels must be packed (community id, belonging coefficient) pairs");
+  auto fs = [&](int c, float w) {
+    auto& cw = vcout[c];
+    if (!cw) vcs.push_back(c);
+    cw += w;
+  };
+  auto fw = [&](O i) {
+    if constexpr (UNWEIGHTED) return 1.0f;
+    else return float(xev[i]);
+  };
+  O i = ib;
+#if defined(COPRA_SCAN_SIMD) && defined(__AVX512F__) && defined(__AVX512CD__)
+  // Each lane is a label of an edge, in edge order (1 edge per lane, or 2 lanes per edge).
+  constexpr O D = 16 / L;
+  const char *base = reinterpret_cast<const char*>(vcom);
+  const __m512i vp = L==1? _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0) : _mm512_set_epi32(7, 7, 6, 6, 5, 5, 4, 4, 3, 3, 2, 2, 1, 1, 0, 0);
+  const __m512i vj = L==1? _mm512_setzero_si512() : _mm512_set_epi32(1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0);
+  const __m512i vl = _mm512_set_epi32(-16, -15, -14, -13, -12, -11, -10, -9, -8, -7, -6, -5, -4, -3, -2, -1);  // distinct labels of inactive lanes
+  const __m512i vu = _mm512_set1_epi32(u);
+  const __m512i z  = _mm512_setzero_si512();
+  const __m512  zf = _mm512_setzero_ps();
+  alignas(64) int cs[16];
+  for (; i+D<=ie; i+=D) {
+    __m512i vv = L==1? _mm512_loadu_si512(xek+i) : _mm512_permutexvar_epi32(vp, _mm512_zextsi256_si512(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(xek+i))));
+    __mmask16 ms = SELF? __mmask16(0xFFFF) : _mm512_cmpneq_epi32_mask(vv, vu);
+    __m512i vi = _mm512_add_epi32(L==1? vv : _mm512_slli_epi32(vv, 1), vj);
+    __m512i vc = _mm512_mask_i32gather_epi32(vl, ms, vi, base, 8);
+    __m512  vw = _mm512_set1_ps(1.0f);
+    if constexpr (!UNWEIGHTED) vw = L==1? _mm512_loadu_ps(xev+i) : _mm512_permutexvar_ps(vp, _mm512_zextps256_ps512(_mm256_loadu_ps(xev+i)));
+    if constexpr (L>1) {
+      // Skip labels after an unused one (zero belonging coefficient).
+      __m512 vb = _mm512_mask_i32gather_ps(zf, ms, vi, base+4, 8);
+      __mmask16 mb = _mm512_mask_cmpneq_ps_mask(ms, vb, zf);
+      ms = mb & __mmask16(0x5555 | ((mb & 0x5555) << 1));
+      vc = _mm512_mask_mov_epi32(vl, ms, vc);
+      vw = _mm512_mul_ps(vw, vb);
+    }
+    // Add to the first remaining lane of each label, until all lanes are added.
+    for (__mmask16 mt=ms; mt;) {
+      __m512i cf = _mm512_conflict_epi32(_mm512_mask_mov_epi32(vl, mt, vc));
+      __mmask16 mn = _mm512_mask_cmpeq_epi32_mask(mt, cf, z);
+      __m512 vo = _mm512_mask_i32gather_ps(zf, mn, vc, vcout.data(), 4);
+      __mmask16 mz = _mm512_mask_cmpeq_ps_mask(mn, vo, zf);
+      if (mz) {
+        _mm512_store_si512(cs, vc);
+        for (; mz; mz &= mz-1)
+          vcs.push_back(cs[__builtin_ctz(mz)]);
+      }
+      _mm512_mask_i32scatter_ps(vcout.data(), mn, vc, _mm512_add_ps(vo, vw), 4);
+      mt &= ~mn;
+    }
+  }
+#elif defined(COPRA_SCAN_SIMD) && defined(__AVX2__)
+  // AVX2 has no scatter, so labels are added in edge order after the gather.
+  const int   *bc = reinterpret_cast<const int*>(vcom);
+  const float *bb = reinterpret_cast<const float*>(vcom) + 1;
+  alignas(32) int   vs[8];
+  alignas(32) int   cs[L][8];
+  alignas(32) float bs[L][8], ws[L][8];
+  for (; i+8<=ie; i+=8) {
+    __m256i vv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xek+i));
+    __m256i vi = L==1? vv : _mm256_slli_epi32(vv, 1);
+    __m256  vw = _mm256_set1_ps(1.0f);
+    if constexpr (!UNWEIGHTED) vw = _mm256_loadu_ps(xev+i);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(vs), vv);
+    for (size_t j=0; j<L; ++j) {
+      __m256i vk = _mm256_add_epi32(vi, _mm256_set1_epi32(int(j)));
+      _mm256_store_si256(reinterpret_cast<__m256i*>(cs[j]), _mm256_i32gather_epi32(bc, vk, 8));
+      if (L==1) { _mm256_store_ps(ws[j], vw); continue; }
+      __m256 vb = _mm256_i32gather_ps(bb, vk, 8);
+      _mm256_store_ps(bs[j], vb);
+      _mm256_store_ps(ws[j], _mm256_mul_ps(vw, vb));
+    }
+    for (int k=0; k<8; ++k) {
+      if (!SELF && vs[k]==u) continue;
+      for (size_t j=0; j<L; ++j) {
+        if (L>1 && !bs[j][k]) break;
+        fs(cs[j][k], ws[j][k]);
+      }
+    }
+  }
+#endif
+  // Remaining edges.
+  for (; i<ie; ++i) {
+    int v = xek[i];
+    if (!SELF && u==v) continue;
+    float w = fw(i);
+    // With a single label, belonging coefficient is always 1 (as in LPA).
+    if (L==1) { fs(vcom[v][0].first, w); continue; }
+    for (const auto& [c, b] : vcom[v]) {
+      if (!b) break;
+      fs(c, w*b);
+    }
+  }
+}
+
 
 
 
@@ -104,28 +1076,91 @@ inline void copraInitialize(vector<Labelset<K, V, L>>& vcom, const G& x) {
  * @param w outgoing edge weight
  * @param vcom community set each vertex belongs to
  */
-template <bool SELF=false, class K, class V, size_t L>
-inline void copraScanCommunity(vector<K>& vcs, vector<V>& vcout, K u, K v, V w, const vector<Labelset<K, V, L>>& vcom) {
+template <bool SELF=false, class K, class C, class V, class M>
+inline void copraScanCommunity(vector<K>& vcs, C& vcout, K u, K v, V w, const M& vcom) {
+  constexpr size_t L = tuple_size<LabelsetOf<M>>::value;
   if (!SELF && u==v) return;
+  // With a single label, belonging coefficient is always 1 (as in LPA).
+  if constexpr (L==1) {
+    K c = vcom[v][0].first;
+    auto& cw = vcout[c];
+    if (!cw) vcs.push_back(c);
+    cw += w;
+    return;
+  }
   for (const auto& [c, b] : vcom[v]) {
     if (!b) break;  // TODO? b -> c
-    if (!vcout[c]) vcs.push_back(c);
-    vcout[c] += w*b;
+    auto& cw = vcout[c];
+    if (!cw) vcs.push_back(c);
+    cw += w*b;
   }
 }
 
 
 /**
  * Scan communities connected to a vertex.
+ * @tparam SELF include self-loops?
+ * @tparam UNWEIGHTED are all edge weights 1 (always, if edges have no values)?
  * @param vcs communities vertex u is linked to (updated)
  * @param vcout total edge weight from vertex u to community C (updated)
  * @param x original graph
  * @param u given vertex
  * @param vcom community set each vertex belongs to
  */
-template <bool SELF=false, class G, class K, class V, size_t L>
-inline void copraScanCommunities(vector<K>& vcs, vector<V>& vcout, const G& x, K u, const vector<Labelset<K, V, L>>& vcom) {
-  x.forEachEdge(u, [&](auto v, auto w) { copraScanCommunity<SELF>(vcs, vcout, u, v, w, vcom); });
+template <bool SELF=false, bool UNWEIGHTED=false, class G, class K, class C, class M>
+inline void copraScanCommunities(vector<K>& vcs, C& vcout, const G& x, K u, const M& vcom) {
+  using V = LabelsetValueOf<M>;
+  constexpr bool NOWEIGHTS = UNWEIGHTED || is_same<typename G::edge_value_type, None>::value;
+  if constexpr (copraScanRows<G, C, M>()) {
+    auto [ib, ie] = x.edgeRange(u);
+    copraScanRowW<SELF, NOWEIGHTS>(vcs, vcout, u, x.ekeys.data(), x.evalues.data(), ib, ie, vcom.data());
+  }
+  else if constexpr (NOWEIGHTS) x.forEachEdgeKey(u, [&](auto v) { copraScanCommunity<SELF>(vcs, vcout, u, v, V(1), vcom); });
+  else x.forEachEdge(u, [&](auto v, auto w) { copraScanCommunity<SELF>(vcs, vcout, u, v, w, vcom); });
+}
+
+
+/**
+ * Get tie-breaking salt of an iteration.
+ * Ties are then broken by a hash of (seed, iteration, vertex, community), which
+ * needs no shared state, so threads and runs see the same ties.
+ * @param seed seed (0 = no salt, same ties in every iteration)
+ * @param l iteration number
+ * @returns tie-breaking salt
+ */
+inline uint64_t copraTieSalt(uint64_t seed, int l) {
+  if (!seed) return 0;
+  return copraMix64(copraMix64(seed) + 0x9e3779b97f4a7c15ULL * (uint64_t(l) + 1));
+}
+
+
+/**
+ * Get tie-breaking key of a community, when scanned by a vertex.
+ * Choosing the smallest community id (or the first scanned) instead tends to
+ * make one label flood the graph, so we use a hash which is stable across runs.
+ * @param u given vertex
+ * @param c community vertex u is linked to
+ * @param r tie-breaking salt (see copraTieSalt())
+ * @returns tie-breaking key (smaller is better)
+ */
+template <class K>
+inline uint64_t copraTieKey(K u, K c, uint64_t r=0) {
+  return copraMix64(((uint64_t(u) << 32) ^ uint64_t(c)) ^ r);
+}
+
+
+/**
+ * Check if community C has more weight than community D, for a vertex.
+ * @param vcout total edge weight from vertex u to community C
+ * @param u given vertex
+ * @param c first community
+ * @param d second community
+ * @param r tie-breaking salt (see copraTieSalt())
+ * @returns is c better than d?
+ */
+template <class K, class C>
+inline bool copraBetterLabel(const C& vcout, K u, K c, K d, uint64_t r=0) {
+  return vcout[c] > vcout[d] || (vcout[c] == vcout[d] && copraTieKey(u, c, r) < copraTieKey(u, d, r));
 }
 
 
@@ -133,10 +1168,12 @@ inline void copraScanCommunities(vector<K>& vcs, vector<V>& vcout, const G& x, K
  * Sort communities scan data by total edge weight / belongingness.
  * @param vcs communities vertex u is linked to (updated)
  * @param vcout total edge weight from vertex u to community C (updated)
+ * @param u given vertex (for tie-breaking)
+ * @param r tie-breaking salt (see copraTieSalt())
  */
-template <class K, class V>
-inline void copraSortScan(vector<K>& vcs, const vector<V>& vcout) {
-  auto fl = [&](auto c, auto d) { return vcout[c] > vcout[d]; };
+template <class K, class C>
+inline void copraSortScan(vector<K>& vcs, const C& vcout, K u, uint64_t r=0) {
+  auto fl = [&](auto c, auto d) { return copraBetterLabel(vcout, u, c, d, r); };
   sortValues(vcs, fl);
 }
 
@@ -152,6 +1189,24 @@ inline void copraClearScan(vector<K>& vcs, vector<V>& vcout) {
     vcout[c] = V();
   vcs.clear();
 }
+template <class K, class V>
+inline void copraClearScan(vector<K>& vcs, CopraScanTable<K, V>& vcout) {
+  vcout.clear();
+  vcs.clear();
+}
+
+
+/**
+ * Prepare communities scan data for a vertex.
+ * @param vcout total edge weight from vertex u to community C (updated)
+ * @param n maximum number of communities vertex u can be linked to (degree * L)
+ */
+template <class V>
+inline void copraReserveScan(vector<V>& vcout, size_t n) {}
+template <class K, class V>
+inline void copraReserveScan(CopraScanTable<K, V>& vcout, size_t n) {
+  vcout.reserve(n);
+}
 
 
 /**
@@ -164,13 +1219,15 @@ inline void copraClearScan(vector<K>& vcs, vector<V>& vcout) {
  * @param W edge weight threshold above which communities are chosen
  * @returns [best community, best edge weight to community]
  */
-template <class G, class K, class V, size_t L>
-inline Labelset<K, V, L> copraChooseCommunity(const G& x, K u, const vector<Labelset<K, V, L>>& vcom, const vector<K>& vcs, const vector<V>& vcout, V W) {
+template <class G, class K, class C, class V, class M>
+inline LabelsetOf<M> copraChooseCommunity(const G& x, K u, const M& vcom, const vector<K>& vcs, const C& vcout, V W) {
+  constexpr size_t L = tuple_size<LabelsetOf<M>>::value;
   K n = K(); V w = V();
-  Labelset<K, V, L> labs;
-  // 1. Find labels above threshold, or best below threshold.
+  LabelsetOf<M> labs;
+  // 1. Find labels above threshold, or best below threshold (bounded by L).
   for (K c : vcs) {
     if (n>K() && vcout[c]<W) break;
+    if (size_t(n)==L) break;
     labs[n++] = {c, vcout[c]};
     w += vcout[c];
   }
@@ -182,6 +1239,48 @@ inline Labelset<K, V, L> copraChooseCommunity(const G& x, K u, const vector<Labe
 }
 
 
+/**
+ * Choose connected communities with most weight, without sorting the scan.
+ * @param x original graph
+ * @param u given vertex
+ * @param vcom community each vertex belongs to
+ * @param vcs communities vertex u is linked to (unsorted)
+ * @param vcout total edge weight from vertex u to community C
+ * @param W edge weight threshold above which communities are chosen
+ * @param r tie-breaking salt (see copraTieSalt())
+ * @returns chosen communities, same as with copraSortScan() + copraChooseCommunity()
+ */
+template <class G, class K, class C, class V, class M>
+inline LabelsetOf<M> copraSelectCommunity(const G& x, K u, const M& vcom, const vector<K>& vcs, const C& vcout, V W, uint64_t r=0) {
+  constexpr size_t L = tuple_size<LabelsetOf<M>>::value;
+  auto fl = [&](auto c, auto d) { return copraBetterLabel(vcout, u, c, d, r); };
+  LabelsetOf<M> labs;
+  if (vcs.empty()) { labs[0] = make_pair(u, V(1)); return labs; }
+  // 1. Find the best label, which is all we need if it is below threshold.
+  K cb = vcs[0];
+  for (K c : vcs)
+    if (fl(c, cb)) cb = c;
+  if (L==1 || vcout[cb]<W) { labs[0] = make_pair(cb, V(1)); return labs; }
+  // 2. Keep top labels above threshold, in order (bounded by L).
+  K cs[L]; size_t n = 0;
+  for (K c : vcs) {
+    if (vcout[c]<W) continue;
+    if (n==L && !fl(c, cs[L-1])) continue;
+    size_t i = n<L? n++ : L-1;
+    for (; i>0 && fl(c, cs[i-1]); --i)
+      cs[i] = cs[i-1];
+    cs[i] = c;
+  }
+  // 3. Normalize labels, such that belonging coefficient sums to 1.
+  V w = V();
+  for (size_t i=0; i<n; ++i)
+    w += vcout[cs[i]];
+  for (size_t i=0; i<n; ++i)
+    labs[i] = make_pair(cs[i], vcout[cs[i]]/w);
+  return labs;
+}
+
+
 
 
 // COPRA-COUNT-COMMUNITIES
@@ -194,8 +1293,8 @@ inline Labelset<K, V, L> copraChooseCommunity(const G& x, K u, const vector<Labe
  * @param x original graph
  * @param vcom community set each vertex belongs to
  */
-template <class G, class K, class V, size_t L>
-inline void copraCountCommunities(vector<K>& gcs, vector<K>& gcnum, const G& x, const vector<Labelset<K, V, L>>& vcom) {
+template <class G, class K, class M>
+inline void copraCountCommunities(vector<K>& gcs, vector<K>& gcnum, const G& x, const M& vcom) {
   x.forEachVertexKey([&](auto u) {
     for (const auto& [c, b] : vcom[u]) {
       if (!b) break;
@@ -235,14 +1334,176 @@ inline K copraMinCount(vector<K> gcs, vector<K>& gcnum) {
 
 
 
+// COPRA-CONVERGENCE
+// -----------------
+// Change in community sets, tracked incrementally in each move iteration.
+
+/**
+ * Find the change in belonging coefficients of a vertex.
+ * @param labs community set before
+ * @param labn community set after
+ * @returns half of L1-distance between coefficients (0 to 1)
+ */
+template <class A>
+inline double copraBelongingDelta(const A& labs, const A& labn) {
+  auto fb = [](const A& x, auto c) {
+    for (const auto& [d, b] : x) {
+      if (!b) break;
+      if (d==c) return double(b);
+    }
+    return 0.0;
+  };
+  double a = 0;
+  for (const auto& [c, b] : labs) {
+    if (!b) break;
+    a += fabs(double(b) - fb(labn, c));
+  }
+  for (const auto& [c, b] : labn) {
+    if (!b) break;
+    if (!fb(labs, c)) a += double(b);
+  }
+  return a / 2;
+}
+
+
+/**
+ * Count number of vertices belonging to each community.
+ * @param vccount number of vertices in each community (output)
+ * @param x original graph
+ * @param vcom community set each vertex belongs to
+ */
+template <class G, class K, class M>
+inline void copraCountVerticesW(vector<K>& vccount, const G& x, const M& vcom) {
+  fillValueU(vccount, K());
+  x.forEachVertexKey([&](auto u) {
+    for (const auto& [c, b] : vcom[u]) {
+      if (!b) break;
+      ++vccount[c];
+    }
+  });
+}
+
+template <class G, class K, class M>
+inline void copraCountVerticesOmpW(vector<K>& vccount, const G& x, const M& vcom) {
+  size_t S = x.span();
+  fillValueOmpU(vccount, K());
+  #pragma omp parallel for schedule(dynamic, 2048)
+  for (size_t u=0; u<S; ++u) {
+    if (!x.hasVertex(u)) continue;
+    for (const auto& [c, b] : vcom[u]) {
+      if (!b) break;
+      #pragma omp atomic
+      ++vccount[c];
+    }
+  }
+}
+
+
+/**
+ * Update number of vertices in each community, upon change of a community set.
+ * @param vccount number of vertices in each community (updated)
+ * @param labs community set before
+ * @param labn community set after
+ */
+template <class K, class A>
+inline void copraUpdateCountU(vector<K>& vccount, const A& labs, const A& labn) {
+  for (const auto& [c, b] : labs) {
+    if (!b) break;
+    --vccount[c];
+  }
+  for (const auto& [c, b] : labn) {
+    if (!b) break;
+    ++vccount[c];
+  }
+}
+
+template <class K, class A>
+inline void copraUpdateCountOmpU(vector<K>& vccount, const A& labs, const A& labn) {
+  for (const auto& [c, b] : labs) {
+    if (!b) break;
+    #pragma omp atomic
+    --vccount[c];
+  }
+  for (const auto& [c, b] : labn) {
+    if (!b) break;
+    #pragma omp atomic
+    ++vccount[c];
+  }
+}
+
+
+/**
+ * Summarize community counts, as in the stopping criterion of the paper.
+ * @param vccount number of vertices in each community
+ * @returns [number of communities, minimum vertices in a community]
+ */
+template <class K>
+inline pair<K, K> copraCountSummary(const vector<K>& vccount) {
+  K n = K(), m = numeric_limits<K>::max();
+  for (K c : vccount) {
+    if (!c) continue;
+    ++n; m = c<m? c : m;
+  }
+  return {n, m};
+}
+
+template <class K>
+inline pair<K, K> copraCountSummaryOmp(const vector<K>& vccount) {
+  size_t S = vccount.size();
+  K n = K(), m = numeric_limits<K>::max();
+  #pragma omp parallel for schedule(static, 2048) reduction(+:n) reduction(min:m)
+  for (size_t i=0; i<S; ++i) {
+    K c = vccount[i];
+    if (!c) continue;
+    ++n; m = c<m? c : m;
+  }
+  return {n, m};
+}
+
+
+/**
+ * Check if iterations have converged.
+ * @param o copra options
+ * @param n number of vertices whose best community changed
+ * @param N number of vertices
+ * @param delta total change in belonging coefficients
+ * @param cnow community count summary after iteration (if COUNT)
+ * @param cold community count summary before iteration (if COUNT)
+ * @returns should iterations stop?
+ */
+template <class K>
+inline bool copraConverged(const CopraOptions& o, K n, K N, double delta, pair<K, K> cnow, pair<K, K> cold) {
+  switch (o.convergence) {
+    default:
+    case CopraConvergence::LABEL:     return float(n)/N <= o.tolerance;
+    case CopraConvergence::COUNT:     return cnow==cold;
+    case CopraConvergence::BELONGING: return delta/N <= o.tolerance;
+  }
+}
+
+
+
+
 // COPRA-BEST-COMMUNITIES
 // ----------------------
 
-template <class K, class V, size_t L>
-inline vector<K> copraBestCommunities(const vector<Labelset<K, V, L>>& vcom) {
+template <class M>
+inline auto copraBestCommunities(const M& vcom) {
+  using K = LabelsetKeyOf<M>;
   K S = vcom.size();
   vector<K> a(S);
-  for (size_t i=0; i<S; ++i)
+  for (K i=0; i<S; ++i)
+    a[i] = vcom[i][0].first;
+  return a;
+}
+
+template <class M>
+inline auto copraBestCommunitiesOmp(const M& vcom) {
+  using K = LabelsetKeyOf<M>;
+  K S = vcom.size();
+  vector<K> a(S);
+  #pragma omp parallel for schedule(auto)
+  for (K i=0; i<S; ++i)
     a[i] = vcom[i][0].first;
   return a;
 }
@@ -250,6 +1511,249 @@ inline vector<K> copraBestCommunities(const vector<Labelset<K, V, L>>& vcom) {
 
 
 
+// COPRA-MODULARITY
+// ----------------
+// Overlapping modularity of the community sets returned, found with one pass
+// after the last iteration. Each vertex is scanned as in a move, but against
+// final community sets of its neighbors, so the value is exact (self-loops
+// are counted, as in modularityOverlapBy()).
+
+/**
+ * Get edge weight from a vertex to its communities, weighted by belonging coefficients.
+ * @param vcout total edge weight from vertex u to community C
+ * @param labs community set of vertex u
+ * @returns sum of b_u(c) * vcout[c]
+ */
+template <class C, class A>
+inline double copraWithinWeight(const C& vcout, const A& labs) {
+  double a = 0;
+  for (const auto& [c, b] : labs) {
+    if (!b) break;
+    a += double(b) * vcout[c];
+  }
+  return a;
+}
+
+
+/**
+ * Get edge weight from a vertex to its communities, weighted by belonging coefficients, by scanning it.
+ * @param vcs communities vertex u is linked to (scratch)
+ * @param vcout total edge weight from vertex u to community C (scratch)
+ * @param x original graph
+ * @param u given vertex
+ * @param vcom community set each vertex belongs to
+ * @returns sum of b_u(c) * vcout[c]
+ */
+template <bool SELF=false, bool UNWEIGHTED=false, class G, class K, class C, class M>
+inline double copraScanWithinWeight(vector<K>& vcs, C& vcout, const G& x, K u, const M& vcom) {
+  constexpr size_t L = tuple_size<LabelsetOf<M>>::value;
+  copraClearScan(vcs, vcout);
+  copraReserveScan(vcout, min(size_t(x.degree(u))*L, size_t(x.span())));
+  copraScanCommunities<SELF, UNWEIGHTED>(vcs, vcout, x, u, vcom);
+  return copraWithinWeight(vcout, vcom[u]);
+}
+
+
+/**
+ * Find total edge weight within communities, weighted by belonging coefficients.
+ * @param vcs communities vertex u is linked to (scratch)
+ * @param vcout total edge weight from vertex u to community C (scratch)
+ * @param x original graph
+ * @param vcom community set each vertex belongs to
+ * @returns sum of b_u(c) * b_v(c) * w(u, v), over all edges and communities
+ */
+template <class G, class K, class C, class M>
+double copraWithinWeightW(vector<K>& vcs, C& vcout, const G& x, const M& vcom) {
+  double a = 0;
+  x.forEachVertexKey([&](auto u) { a += copraScanWithinWeight<true>(vcs, vcout, x, K(u), vcom); });
+  copraClearScan(vcs, vcout);
+  return a;
+}
+
+template <class G, class K, class C, class M>
+double copraWithinWeightOmpW(vector<vector<K>*>& vcs, vector<C*>& vcout, const G& x, const M& vcom) {
+  K S = x.span();
+  double a = 0;
+  #pragma omp parallel reduction(+:a)
+  {
+    int t = omp_get_thread_num();
+    #pragma omp for schedule(dynamic, 2048)
+    for (K u=0; u<S; ++u) {
+      if (!x.hasVertex(u)) continue;
+      a += copraScanWithinWeight<true>(*vcs[t], *vcout[t], x, u, vcom);
+    }
+    copraClearScan(*vcs[t], *vcout[t]);
+  }
+  return a;
+}
+
+
+/**
+ * Find the overlapping modularity of community sets, from edge weight within communities.
+ * @param vctot total edge weight of each community (scratch)
+ * @param x original graph
+ * @param vcom community set each vertex belongs to
+ * @param vtot total edge weight of each vertex
+ * @param cin total edge weight within communities, weighted by belonging coefficients
+ * @param R resolution (0, 1]
+ * @returns overlapping modularity [-0.5, 1] (see modularityOverlapBy)
+ */
+template <class G, class M, class V>
+double copraModularityW(vector<V>& vctot, const G& x, const M& vcom, const vector<V>& vtot, double cin, double R=1) {
+  size_t S = x.span();
+  double m = 0, a = 0;
+  fill(vctot.begin(), vctot.end(), V());
+  x.forEachVertexKey([&](auto u) {
+    m += vtot[u];
+    for (const auto& [c, b] : vcom[u]) {
+      if (!b) break;
+      vctot[c] += b*vtot[u];
+    }
+  });
+  for (size_t c=0; c<S; ++c)
+    a += double(vctot[c]) * vctot[c];
+  return m>0? cin/m - R*a/(m*m) : 0;
+}
+
+template <class G, class M, class V>
+double copraModularityOmpW(vector<V>& vctot, const G& x, const M& vcom, const vector<V>& vtot, double cin, double R=1) {
+  using K = typename G::key_type;
+  K S = x.span();
+  double m = 0, a = 0;
+  fillValueOmpU(vctot, V());
+  #pragma omp parallel for schedule(auto) reduction(+:m)
+  for (K u=0; u<S; ++u) {
+    if (!x.hasVertex(u)) continue;
+    m += vtot[u];
+    for (const auto& [c, b] : vcom[u]) {
+      if (!b) break;
+      V w = b*vtot[u];
+      #pragma omp atomic
+      vctot[c] += w;
+    }
+  }
+  #pragma omp parallel for schedule(auto) reduction(+:a)
+  for (K c=0; c<S; ++c)
+    a += double(vctot[c]) * vctot[c];
+  return m>0? cin/m - R*a/(m*m) : 0;
+}
+
+
+
+
+// COPRA-COMPACT-LABELSETS
+// -----------------------
+
+/**
+ * Store community set of each vertex in CSR form, keeping only non-zero labels.
+ * @param aoff offset of labels of each vertex (updated)
+ * @param alab (community, belonging coefficient) of each vertex, in order (updated)
+ * @param vcom community set each vertex belongs to
+ */
+template <class K, class V, class M>
+void copraCompactLabelsetsW(vector<size_t>& aoff, vector<pair<K, V>>& alab, const M& vcom) {
+  size_t S = vcom.size();
+  aoff.resize(S+1);
+  for (size_t u=0; u<S; ++u) {
+    size_t n = 0;
+    for (const auto& [c, b] : vcom[u]) {
+      if (!b) break;
+      ++n;
+    }
+    aoff[u] = n;
+  }
+  aoff[S] = 0;
+  exclusiveScanW(aoff, aoff);
+  alab.resize(aoff[S]);
+  for (size_t u=0; u<S; ++u) {
+    for (size_t i=aoff[u], j=0; i<aoff[u+1]; ++i, ++j)
+      alab[i] = vcom[u][j];
+  }
+}
+
+template <class K, class V, class M>
+void copraCompactLabelsetsOmpW(vector<size_t>& aoff, vector<pair<K, V>>& alab, const M& vcom) {
+  size_t S = vcom.size();
+  aoff.resize(S+1);
+  #pragma omp parallel for schedule(auto)
+  for (size_t u=0; u<S; ++u) {
+    size_t n = 0;
+    for (const auto& [c, b] : vcom[u]) {
+      if (!b) break;
+      ++n;
+    }
+    aoff[u] = n;
+  }
+  aoff[S] = 0;
+  exclusiveScanW(aoff, aoff);
+  alab.resize(aoff[S]);
+  #pragma omp parallel for schedule(auto)
+  for (size_t u=0; u<S; ++u) {
+    for (size_t i=aoff[u], j=0; i<aoff[u+1]; ++i, ++j)
+      alab[i] = vcom[u][j];
+  }
+}
+
+
+/**
+ * Obtain community set of each vertex from CSR form (see copraCompactLabelsetsW).
+ * @param vcom community set each vertex belongs to (updated)
+ * @param xoff offset of labels of each vertex
+ * @param xlab (community, belonging coefficient) of each vertex, in order
+ */
+template <class M, class K, class V>
+void copraExpandLabelsetsW(M& vcom, const vector<size_t>& xoff, const vector<pair<K, V>>& xlab) {
+  constexpr size_t L = tuple_size<LabelsetOf<M>>::value;
+  size_t S = xoff.size()-1;
+  vcom.resize(S);
+  for (size_t u=0; u<S; ++u) {
+    size_t n = 0;
+    LabelsetOf<M> labs = {};
+    for (size_t i=xoff[u]; i<xoff[u+1] && n<L; ++i)
+      labs[n++] = xlab[i];
+    vcom[u] = labs;
+  }
+}
+
+
+
+
+// COPRA-RESTORE-ORDER
+// -------------------
+// Communities found on a relabeled graph (see reorder.hxx), in original ids.
+
+/**
+ * Map communities found on a relabeled graph back to original vertex ids.
+ * Communities are named by a vertex, so their ids are mapped as well.
+ * @param a copra result on relabeled graph (updated)
+ * @param ks old id of each new id
+ */
+template <class K, class V>
+void copraRestoreOrderU(CopraResult<K, V>& a, const vector<K>& ks) {
+  size_t S = a.membership.size();
+  vector<K> vmem(S);
+  for (size_t i=0; i<S; ++i)
+    vmem[ks[i]] = ks[a.membership[i]];
+  a.membership = move(vmem);
+  if (a.labelsetOffsets.empty()) return;
+  vector<size_t> aoff(S+1);
+  vector<pair<K, V>> alab(a.labelsets.size());
+  for (size_t i=0; i<S; ++i)
+    aoff[ks[i]] = a.labelsetOffsets[i+1] - a.labelsetOffsets[i];
+  aoff[S] = 0;
+  exclusiveScanW(aoff, aoff);
+  for (size_t i=0; i<S; ++i) {
+    size_t j = aoff[ks[i]];
+    for (size_t k=a.labelsetOffsets[i]; k<a.labelsetOffsets[i+1]; ++k)
+      alab[j++] = {ks[a.labelsets[k].first], a.labelsets[k].second};
+  }
+  a.labelsetOffsets = move(aoff);
+  a.labelsets = move(alab);
+}
+
+
+
+
 // COPRA-AFFECTED-VERTICES-DELTA-SCREENING
 // ---------------------------------------
 // Using delta-screening approach.
@@ -260,27 +1764,33 @@ inline vector<K> copraBestCommunities(const vector<Labelset<K, V, L>>& vcom) {
 //   `i`'s neighbors and `j`'s community is marked as affected.
 
 /**
- * Find the vertices which should be processed upon a batch of edge insertions and deletions.
+ * Screen a batch of edge insertions and deletions, for vertices whose neighbors are affected, and affected communities.
+ * @param us vertices whose neighbors are affected (output)
+ * @param cs affected communities (output)
+ * @param neighbors flags for each vertex marking whether its neighbors are affected (updated, for vertices in us)
+ * @param communities flags for each community marking whether it is affected (updated, for communities in cs)
+ * @param vcs communities vertex u is linked to (scratch)
+ * @param vcout total edge weight from vertex u to community C (scratch)
  * @param x original graph
  * @param deletions edge deletions for this batch update (undirected, sorted by source vertex id)
  * @param insertions edge insertions for this batch update (undirected, sorted by source vertex id)
  * @param vcom community set each vertex belongs to
  * @param vtot total edge weight of each vertex
  * @param B belonging coefficient threshold
- * @returns flags for each vertex marking whether it is affected
  */
-template <class FLAG=bool, class G, class K, class V, size_t L>
-auto copraAffectedVerticesDeltaScreening(const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const vector<Labelset<K, V, L>>& vcom, const vector<V>& vtot, V B) {
-  K S = x.span();
-  vector<K> vcs; vector<V> vcout(S);
-  vector<FLAG> vertices(S), neighbors(S), communities(S);
+template <class FLAG, class G, class K, class V, class M>
+void copraScreenBatchW(vector<K>& us, vector<K>& cs, vector<FLAG>& neighbors, vector<FLAG>& communities, vector<K>& vcs, vector<V>& vcout, const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const M& vcom, const vector<V>& vtot, V B) {
+  auto fm = [&](K u, K c) {
+    if (!neighbors[u])   { neighbors[u] = true;   us.push_back(u); }
+    if (!communities[c]) { communities[c] = true; cs.push_back(c); }
+  };
+  us.clear();
+  cs.clear();
   for (const auto& [u, v] : deletions) {
     K cu = vcom[u][0].first;
     K cv = vcom[v][0].first;
     if (cu!=cv) continue;
-    vertices[u]  = true;
-    neighbors[u] = true;
-    communities[cv] = true;
+    fm(u, cv);
   }
   for (size_t i=0; i<insertions.size();) {
     K u = get<0>(insertions[i]);
@@ -293,19 +1803,90 @@ auto copraAffectedVerticesDeltaScreening(const G& x, const vector<tuple<K, K>>&
       if (cu==cv) continue;
       copraScanCommunity(vcs, vcout, u, v, w, vcom);
     }
+    if (vcs.empty()) continue;
+    copraSortScan(vcs, vcout, u);
     auto labs = copraChooseCommunity(x, u, vcom, vcs, vcout, B*vtot[u]);
     K cu = vcom[u][0].first;
     K cl = labs[0].first;
     if (cl==cu) continue;
-    vertices[u]  = true;
-    neighbors[u] = true;
-    communities[cl] = true;
+    fm(u, cl);
   }
-  x.forEachVertexKey([&](auto u) {
-    K cu = vcom[u][0].first;
-    if (neighbors[u]) x.forEachEdgeKey(u, [&](auto v) { vertices[v] = true; });
-    if (communities[cu]) vertices[u] = true;
-  });
+  copraClearScan(vcs, vcout);
+}
+
+
+/**
+ * Find the vertices which should be processed upon a batch of edge insertions and deletions.
+ * @param vertices flags for each vertex marking whether it is affected (output)
+ * @param neighbors flags for each vertex marking whether its neighbors are affected (scratch, all unset before and after)
+ * @param communities flags for each community marking whether it is affected (scratch, all unset before and after)
+ * @param vcs communities vertex u is linked to (scratch)
+ * @param vcout total edge weight from vertex u to community C (scratch)
+ * @param x original graph
+ * @param deletions edge deletions for this batch update (undirected, sorted by source vertex id)
+ * @param insertions edge insertions for this batch update (undirected, sorted by source vertex id)
+ * @param vcom community set each vertex belongs to
+ * @param vtot total edge weight of each vertex
+ * @param B belonging coefficient threshold
+ */
+template <class FLAG, class G, class K, class V, class M>
+void copraAffectedVerticesDeltaScreeningW(vector<FLAG>& vertices, vector<FLAG>& neighbors, vector<FLAG>& communities, vector<K>& vcs, vector<V>& vcout, const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const M& vcom, const vector<V>& vtot, V B) {
+  K S = x.span();
+  vector<K> us, cs;
+  copraScreenBatchW(us, cs, neighbors, communities, vcs, vcout, x, deletions, insertions, vcom, vtot, B);
+  for (K u=0; u<S; ++u)
+    vertices[u] = x.hasVertex(u) && communities[vcom[u][0].first];
+  for (K u : us) {
+    vertices[u] = true;
+    x.forEachEdgeKey(u, [&](auto v) { vertices[v] = true; });
+  }
+  // Only flags that were set are reset.
+  for (K u : us) neighbors[u]   = FLAG();
+  for (K c : cs) communities[c] = FLAG();
+}
+
+
+/**
+ * Find the vertices which should be processed upon a batch of edge insertions and deletions, using multiple threads.
+ * @param vertices flags for each vertex marking whether it is affected (output)
+ * @param neighbors flags for each vertex marking whether its neighbors are affected (scratch, all unset before and after)
+ * @param communities flags for each community marking whether it is affected (scratch, all unset before and after)
+ * @param vcs communities vertex u is linked to (scratch)
+ * @param vcout total edge weight from vertex u to community C (scratch)
+ * @param x original graph
+ * @param deletions edge deletions for this batch update (undirected, sorted by source vertex id)
+ * @param insertions edge insertions for this batch update (undirected, sorted by source vertex id)
+ * @param vcom community set each vertex belongs to
+ * @param vtot total edge weight of each vertex
+ * @param B belonging coefficient threshold
+ */
+template <class FLAG, class G, class K, class V, class M>
+void copraAffectedVerticesDeltaScreeningOmpW(vector<FLAG>& vertices, vector<FLAG>& neighbors, vector<FLAG>& communities, vector<K>& vcs, vector<V>& vcout, const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const M& vcom, const vector<V>& vtot, V B) {
+  K S = x.span();
+  vector<K> us, cs;
+  // Screening is proportional to the batch, so it is left sequential.
+  copraScreenBatchW(us, cs, neighbors, communities, vcs, vcout, x, deletions, insertions, vcom, vtot, B);
+  #pragma omp parallel for schedule(auto)
+  for (K u=0; u<S; ++u)
+    vertices[u] = x.hasVertex(u) && communities[vcom[u][0].first];
+  size_t U = us.size();
+  #pragma omp parallel for schedule(dynamic, 64)
+  for (size_t i=0; i<U; ++i) {
+    K u = us[i];
+    vertices[u] = true;
+    x.forEachEdgeKey(u, [&](auto v) { vertices[v] = true; });
+  }
+  // Only flags that were set are reset.
+  for (K u : us) neighbors[u]   = FLAG();
+  for (K c : cs) communities[c] = FLAG();
+}
+
+template <class FLAG=bool, class G, class K, class V, class M>
+inline auto copraAffectedVerticesDeltaScreening(const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const M& vcom, const vector<V>& vtot, V B) {
+  K S = x.span();
+  vector<K> vcs; vector<V> vcout(S);
+  vector<FLAG> vertices(S), neighbors(S), communities(S);
+  copraAffectedVerticesDeltaScreeningW(vertices, neighbors, communities, vcs, vcout, x, deletions, insertions, vcom, vtot, B);
   return vertices;
 }
 
@@ -324,16 +1905,15 @@ auto copraAffectedVerticesDeltaScreening(const G& x, const vector<tuple<K, K>>&
 
 /**
  * Find the vertices which should be processed upon a batch of edge insertions and deletions.
+ * @param vertices flags for each vertex marking whether it is affected (output)
  * @param x original graph
  * @param deletions edge deletions for this batch update (undirected, sorted by source vertex id)
  * @param insertions edge insertions for this batch update (undirected, sorted by source vertex id)
  * @param vcom community set each vertex belongs to
- * @returns flags for each vertex marking whether it is affected
  */
-template <class FLAG=bool, class G, class K, class V, size_t L>
-auto copraAffectedVerticesFrontier(const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const vector<Labelset<K, V, L>>& vcom) {
-  K S = x.span();
-  vector<FLAG> vertices(S);
+template <class FLAG, class G, class K, class V, class M>
+void copraAffectedVerticesFrontierW(vector<FLAG>& vertices, const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const M& vcom) {
+  fill(vertices.begin(), vertices.end(), FLAG());
   for (const auto& [u, v] : deletions) {
     K cu = vcom[u][0].first;
     K cv = vcom[v][0].first;
@@ -346,5 +1926,12 @@ auto copraAffectedVerticesFrontier(const G& x, const vector<tuple<K, K>>& deleti
     if (cu==cv) continue;
     vertices[u] = true;
   }
+}
+
+template <class FLAG=bool, class G, class K, class V, class M>
+inline auto copraAffectedVerticesFrontier(const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const M& vcom) {
+  K S = x.span();
+  vector<FLAG> vertices(S);
+  copraAffectedVerticesFrontierW(vertices, x, deletions, insertions, vcom);
   return vertices;
 }
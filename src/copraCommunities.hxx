@@ -0,0 +1,311 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <omp.h>
+#include "_main.hxx"
+#include "bin.hxx"
+#include "copra.hxx"
+
+using std::pair;
+using std::string;
+using std::vector;
+using std::ios;
+using std::ifstream;
+using std::ofstream;
+using std::memcpy;
+using std::memcmp;
+using std::decay_t;
+using std::sort;
+using std::max;
+
+
+
+
+// COPRA-COMMUNITIES
+// -----------------
+// Communities of a COPRA run, with dense ids, and their members (as CSR).
+
+template <class K, class V=float>
+struct CopraCommunities {
+  vector<K>      ids;          // original label of each community (communities are numbered 0..C-1, in order of label)
+  vector<size_t> offsets;      // members of community c are in [offsets[c], offsets[c+1])
+  vector<K>      members;      // member vertices of each community, in order of vertex id
+  vector<V>      belongings;   // belonging coefficient of each member
+  vector<size_t> sizeHistogram;     // number of communities of size in [2^i, 2^(i+1))
+  vector<size_t> overlapHistogram;  // number of vertices belonging to i communities
+  size_t overlapping = 0;      // vertices belonging to more than one community
+  size_t maxSize     = 0;      // members in the largest community
+  float  time        = 0;      // time taken to build (ms)
+
+  inline size_t communities() const noexcept { return ids.size(); }
+  inline size_t bytes() const noexcept {
+    return ids.size()*sizeof(K) + offsets.size()*sizeof(size_t) + members.size()*(sizeof(K) + sizeof(V));
+  }
+};
+
+
+
+
+// COPRA-COMMUNITIES-BUILD
+// -----------------------
+// Labels are read twice: first to count members of each label, and vertices
+// with each number of labels, and then to scatter members into their
+// communities. Labels in use are numbered in order with a prefix sum, and
+// each community is then sorted, so the result does not depend on threads.
+
+/**
+ * Find communities, with dense ids, and their members.
+ * @param a communities (output)
+ * @param x original graph
+ * @param fl called with each vertex, and a function to call with each of its labels (u, fn(c, b))
+ */
+template <class G, class K, class V, class FL>
+void copraCommunitiesOmpDoW(CopraCommunities<K, V>& a, const G& x, FL fl) {
+  K S = x.span();
+  int T = omp_get_max_threads();
+  vector<K> vsize(S);
+  vector<vector<size_t>> ohs(T);
+  auto t0 = timeNow();
+  // Count members of each label, and labels of each vertex.
+  #pragma omp parallel
+  {
+    int t = omp_get_thread_num();
+    auto& oh = ohs[t];
+    #pragma omp for schedule(dynamic, 2048)
+    for (K u=0; u<S; ++u) {
+      if (!x.hasVertex(u)) continue;
+      size_t n = 0;
+      fl(u, [&](K c, V b) {
+        #pragma omp atomic
+        ++vsize[c];
+        ++n;
+      });
+      if (oh.size()<=n) oh.resize(n+1);
+      ++oh[n];
+    }
+  }
+  // Number labels in use densely, and find offsets of their members.
+  vector<K> vid(S+1);
+  #pragma omp parallel for schedule(auto)
+  for (K c=0; c<S; ++c)
+    vid[c] = vsize[c]? 1 : 0;
+  vid[S] = 0;
+  exclusiveScanW(vid, vid);
+  K C = vid[S];
+  a.ids.resize(C);
+  a.offsets.resize(C+1);
+  #pragma omp parallel for schedule(auto)
+  for (K c=0; c<S; ++c) {
+    if (!vsize[c]) continue;
+    a.ids[vid[c]]     = c;
+    a.offsets[vid[c]] = vsize[c];
+  }
+  a.offsets[C] = 0;
+  exclusiveScanW(a.offsets, a.offsets);
+  size_t N = a.offsets[C];
+  // Scatter members into their communities, and sort each community.
+  vector<pair<K, V>> mbs(N);
+  vector<size_t> next(a.offsets.begin(), a.offsets.end()-1);
+  #pragma omp parallel for schedule(dynamic, 2048)
+  for (K u=0; u<S; ++u) {
+    if (!x.hasVertex(u)) continue;
+    fl(u, [&](K c, V b) {
+      size_t j;
+      #pragma omp atomic capture
+      j = next[vid[c]]++;
+      mbs[j] = {u, b};
+    });
+  }
+  a.members.resize(N);
+  a.belongings.resize(N);
+  size_t maxSize = 0;
+  vector<vector<size_t>> shs(T);
+  #pragma omp parallel reduction(max:maxSize)
+  {
+    int t = omp_get_thread_num();
+    auto& sh = shs[t];
+    #pragma omp for schedule(dynamic, 256)
+    for (K d=0; d<C; ++d) {
+      size_t ib = a.offsets[d], ie = a.offsets[d+1];
+      sort(mbs.begin()+ib, mbs.begin()+ie, [](const auto& p, const auto& q) { return p.first < q.first; });
+      for (size_t j=ib; j<ie; ++j) {
+        a.members[j]    = mbs[j].first;
+        a.belongings[j] = mbs[j].second;
+      }
+      size_t n = ie - ib, i = 0;
+      while (n >>= 1) ++i;
+      if (sh.size()<=i) sh.resize(i+1);
+      ++sh[i];
+      maxSize = max(maxSize, ie - ib);
+    }
+  }
+  // Combine histograms of all threads.
+  auto fh = [](vector<size_t>& h, const vector<vector<size_t>>& hs) {
+    h.clear();
+    for (const auto& g : hs) {
+      if (h.size()<g.size()) h.resize(g.size());
+      for (size_t i=0; i<g.size(); ++i)
+        h[i] += g[i];
+    }
+  };
+  fh(a.sizeHistogram,    shs);
+  fh(a.overlapHistogram, ohs);
+  a.overlapping = 0;
+  for (size_t i=2; i<a.overlapHistogram.size(); ++i)
+    a.overlapping += a.overlapHistogram[i];
+  a.maxSize = maxSize;
+  a.time    = durationMilliseconds(t0, timeNow());
+}
+
+
+/**
+ * Find communities, with dense ids, and their members, from community sets of vertices.
+ * @param a communities (output)
+ * @param x original graph
+ * @param vcom community set each vertex belongs to (LabelsetVector, CompactLabelsets, ...)
+ */
+template <class G, class K, class V, class M>
+inline void copraCommunitiesOmpW(CopraCommunities<K, V>& a, const G& x, const M& vcom) {
+  copraCommunitiesOmpDoW(a, x, [&](K u, auto fn) {
+    for (const auto& [c, b] : vcom[u]) {
+      if (!b) break;
+      fn(K(c), V(b));
+    }
+  });
+}
+
+
+/**
+ * Find communities, with dense ids, and their members, from the result of a COPRA run.
+ * @param a communities (output)
+ * @param x original graph
+ * @param r copra result (labelsets if saved, otherwise best community of each vertex)
+ */
+template <class G, class K, class V>
+inline void copraCommunitiesOmpW(CopraCommunities<K, V>& a, const G& x, const CopraResult<K, V>& r) {
+  if (r.labelsetOffsets.empty()) copraCommunitiesOmpDoW(a, x, [&](K u, auto fn) { fn(r.membership[u], V(1)); });
+  else copraCommunitiesOmpDoW(a, x, [&](K u, auto fn) {
+    for (size_t i=r.labelsetOffsets[u]; i<r.labelsetOffsets[u+1]; ++i)
+      fn(r.labelsets[i].first, r.labelsets[i].second);
+  });
+}
+
+
+
+
+// COPRA-COMMUNITIES-BIN
+// ---------------------
+// Binary export of communities, written directly from their arrays.
+// Layout: header, ids[C], offsets[C+1] (uint64), members[N], belongings[N],
+// sizeHistogram[H] (uint64), overlapHistogram[O] (uint64); each section is
+// padded to 8 bytes (see binPadded()).
+
+#define COPRA_COMMUNITIES_MAGIC   "COPRACOM"
+#define COPRA_COMMUNITIES_VERSION 1
+
+
+struct CopraCommunitiesHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t keyBytes;
+  uint32_t valueBytes;
+  uint32_t reserved;
+  uint64_t communities;
+  uint64_t members;
+  uint64_t sizeBins;
+  uint64_t overlapBins;
+  uint64_t overlapping;
+  uint64_t maxSize;
+};
+
+
+/**
+ * Write communities as a binary file.
+ * @param pth path to file
+ * @param a communities (see copraCommunitiesOmpW())
+ * @returns true if written
+ */
+template <class K, class V>
+bool writeCopraCommunitiesBin(const string& pth, const CopraCommunities<K, V>& a) {
+  static_assert(sizeof(size_t)==sizeof(uint64_t), "Offsets are written as 64-bit integers!");
+  CopraCommunitiesHeader h = {};
+  memcpy(h.magic, COPRA_COMMUNITIES_MAGIC, 8);
+  h.version     = COPRA_COMMUNITIES_VERSION;
+  h.keyBytes    = sizeof(K);
+  h.valueBytes  = sizeof(V);
+  h.communities = a.ids.size();
+  h.members     = a.members.size();
+  h.sizeBins    = a.sizeHistogram.size();
+  h.overlapBins = a.overlapHistogram.size();
+  h.overlapping = a.overlapping;
+  h.maxSize     = a.maxSize;
+  const char pad[8] = {};
+  auto fw = [&](ofstream& f, const void *p, size_t N) {
+    f.write((const char*) p, N);
+    f.write(pad, binPadded(N) - N);
+  };
+  ofstream f(pth, ios::binary);
+  if (!f) return false;
+  fw(f, &h, sizeof(h));
+  fw(f, a.ids.data(),        a.ids.size() * sizeof(K));
+  fw(f, a.offsets.data(),    a.offsets.size() * sizeof(size_t));
+  fw(f, a.members.data(),    a.members.size() * sizeof(K));
+  fw(f, a.belongings.data(), a.belongings.size() * sizeof(V));
+  fw(f, a.sizeHistogram.data(),    a.sizeHistogram.size() * sizeof(size_t));
+  fw(f, a.overlapHistogram.data(), a.overlapHistogram.size() * sizeof(size_t));
+  f.close();
+  return bool(f);
+}
+
+
+/**
+ * Read communities from a binary file.
+ * @param a communities (output)
+ * @param pth path to file
+ * @returns true if read (false if missing, truncated, or of another type)
+ */
+template <class K, class V>
+bool readCopraCommunitiesBinW(CopraCommunities<K, V>& a, const string& pth) {
+  CopraCommunitiesHeader h = {};
+  ifstream f(pth, ios::binary);
+  if (!f || !f.read((char*) &h, sizeof(h))) return false;
+  if (memcmp(h.magic, COPRA_COMMUNITIES_MAGIC, 8)!=0 || h.version!=COPRA_COMMUNITIES_VERSION) return false;
+  if (h.keyBytes!=sizeof(K) || h.valueBytes!=sizeof(V)) return false;
+  // Sections must fit in the file, before anything is allocated for them.
+  f.seekg(0, ios::end);
+  size_t F = size_t(f.tellg()), E = binPadded(sizeof(h));
+  const pair<uint64_t, size_t> ss[] = {
+    {h.communities, sizeof(K)}, {h.communities + 1, sizeof(size_t)},
+    {h.members, sizeof(K)}, {h.members, sizeof(V)},
+    {h.sizeBins, sizeof(size_t)}, {h.overlapBins, sizeof(size_t)}
+  };
+  for (const auto& [n, b] : ss) {
+    if (n > F/b) return false;
+    E += binPadded(n * b);
+  }
+  if (!f || E > F) return false;
+  f.seekg(binPadded(sizeof(h)));
+  auto fr = [&](auto& x, size_t n) {
+    using T = typename decay_t<decltype(x)>::value_type;
+    size_t N = n * sizeof(T);
+    char buf[8];
+    x.resize(n);
+    f.read((char*) x.data(), N);
+    f.read(buf, binPadded(N) - N);
+  };
+  fr(a.ids,        h.communities);
+  fr(a.offsets,    h.communities + 1);
+  fr(a.members,    h.members);
+  fr(a.belongings, h.members);
+  fr(a.sizeHistogram,    h.sizeBins);
+  fr(a.overlapHistogram, h.overlapBins);
+  a.overlapping = h.overlapping;
+  a.maxSize     = h.maxSize;
+  return bool(f);
+}
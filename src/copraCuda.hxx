@@ -0,0 +1,574 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <type_traits>
+#include <algorithm>
+#include "_main.hxx"
+#include "_cuda.hxx"
+#include "copra.hxx"
+
+using std::vector;
+using std::swap;
+using std::min;
+using std::max;
+using std::move;
+using std::is_signed;
+
+
+
+
+// COPRA-CUDA-CONFIG
+// -----------------
+// Vertices are processed by a warp each, unless their scan does not fit in the
+// shared memory of a warp (or they have more than hubDegree edges). Then they are
+// processed by a block each, with scans of the largest hubs in global memory.
+// The largest hubs are launched apart, on a small grid, so that global tables
+// are only needed for the few blocks that process them.
+
+// Threads per block, when each vertex is processed by a warp.
+#ifndef COPRA_CUDA_WARP_BLOCK
+#define COPRA_CUDA_WARP_BLOCK 128
+#endif
+
+// Hash table slots of each warp in shared memory (power of 2, at least 2 * degree * labels).
+#ifndef COPRA_CUDA_WARP_SLOTS
+#define COPRA_CUDA_WARP_SLOTS 256
+#endif
+
+// Threads per block, when each vertex is processed by a block (hubs).
+#ifndef COPRA_CUDA_HUB_BLOCK
+#define COPRA_CUDA_HUB_BLOCK 256
+#endif
+
+// Hash table slots of each block in shared memory (power of 2).
+#ifndef COPRA_CUDA_HUB_SLOTS
+#define COPRA_CUDA_HUB_SLOTS 2048
+#endif
+
+// Maximum number of blocks processing hubs, whose scan fits in shared memory.
+#ifndef COPRA_CUDA_HUB_GRID
+#define COPRA_CUDA_HUB_GRID 1024
+#endif
+
+// Maximum number of blocks processing the largest hubs (each has its own table in global memory).
+#ifndef COPRA_CUDA_BIG_GRID
+#define COPRA_CUDA_BIG_GRID 32
+#endif
+
+// Maximum number of blocks processing low degree vertices.
+#ifndef COPRA_CUDA_GRID
+#define COPRA_CUDA_GRID 4096
+#endif
+
+
+
+
+// COPRA-CUDA-LABELS
+// -----------------
+// Same tie-breaking, and order of labels as copraTieKey(), and copraBetterLabel().
+// Community ids must be signed, as an empty label is -1.
+
+/**
+ * Mix bits of a 64-bit integer (same as copraMix64()).
+ * @param h given integer
+ * @returns mixed integer
+ */
+__device__ inline uint64_t copraMix64Cud(uint64_t h) {
+  h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+  return h ^ (h >> 31);
+}
+
+
+/**
+ * Get tie-breaking key of a community, when scanned by a vertex (same as copraTieKey()).
+ * @param u given vertex
+ * @param c community vertex u is linked to
+ * @param r tie-breaking salt (see copraTieSalt())
+ * @returns tie-breaking key (smaller is better)
+ */
+template <class K>
+__device__ inline uint64_t copraTieKeyCud(K u, K c, uint64_t r) {
+  return copraMix64Cud(((uint64_t(u) << 32) ^ uint64_t(c)) ^ r);
+}
+
+
+/**
+ * Check if community C has more weight than community D, for a vertex (empty labels are worst).
+ * @param u given vertex
+ * @param c first community (or -1)
+ * @param wc total edge weight from vertex u to community c
+ * @param d second community (or -1)
+ * @param wd total edge weight from vertex u to community d
+ * @param r tie-breaking salt (see copraTieSalt())
+ * @returns is c better than d?
+ */
+template <class K, class V>
+__device__ inline bool copraBetterLabelCud(K u, K c, V wc, K d, V wd, uint64_t r) {
+  if (c<K()) return false;
+  if (d<K()) return true;
+  return wc > wd || (wc == wd && copraTieKeyCud(u, c, r) < copraTieKeyCud(u, d, r));
+}
+
+
+
+
+// COPRA-CUDA-SCAN
+// ---------------
+// Scans are accumulated in an open addressing hash table, shared by a warp (or block).
+
+/**
+ * Get number of hash table slots needed for a scan.
+ * @param n maximum number of communities a vertex can be linked to (degree * L)
+ * @returns number of slots (power of 2, at least 2n)
+ */
+__host__ __device__ inline size_t copraScanSlotsCud(size_t n) {
+  size_t H = 2;
+  while (H < 2*n) H *= 2;
+  return H;
+}
+
+
+/**
+ * Clear a hash table of a scan, with a group of threads.
+ * @param hk community of each slot (updated)
+ * @param hv total edge weight to community of each slot (updated)
+ * @param H number of slots
+ * @param t thread index in group
+ * @param T number of threads in group
+ */
+template <class K, class V>
+__device__ inline void copraClearScanCud(K *hk, V *hv, size_t H, size_t t, size_t T) {
+  for (size_t i=t; i<H; i+=T) {
+    hk[i] = K(-1);
+    hv[i] = V();
+  }
+}
+
+
+/**
+ * Add edge weight to a community in a hash table of a scan.
+ * @param hk community of each slot (updated)
+ * @param hv total edge weight to community of each slot (updated)
+ * @param H number of slots (power of 2)
+ * @param c community
+ * @param w edge weight to add
+ */
+template <class K, class V>
+__device__ inline void copraAccumulateCud(K *hk, V *hv, size_t H, K c, V w) {
+  for (size_t i=(uint32_t(c) * 2654435761U) & (H-1);; i=(i+1) & (H-1)) {
+    K k = ((volatile K*) hk)[i];
+    if (k==K(-1)) k = atomicCAS(&hk[i], K(-1), c);
+    if (k==K(-1) || k==c) { atomicAdd(&hv[i], w); return; }
+  }
+}
+
+
+/**
+ * Scan communities connected to a vertex, with a group of threads.
+ * @param hk community of each slot (updated)
+ * @param hv total edge weight to community of each slot (updated)
+ * @param H number of slots (power of 2)
+ * @param u given vertex
+ * @param xoff offsets of original graph (CSR)
+ * @param xedk edge keys of original graph (CSR)
+ * @param xedw edge values of original graph (CSR)
+ * @param comk community of each label of each vertex (L per vertex)
+ * @param comb belonging coefficient of each label of each vertex (L per vertex)
+ * @param t thread index in group
+ * @param T number of threads in group
+ */
+template <size_t L, bool SELF=false, class K, class V, class O>
+__device__ inline void copraScanCommunitiesCud(K *hk, V *hv, size_t H, K u, const O *xoff, const K *xedk, const V *xedw, const K *comk, const V *comb, size_t t, size_t T) {
+  for (O i=xoff[u]+t; i<xoff[u+1]; i+=T) {
+    K v = xedk[i];
+    V w = xedw[i];
+    if (!SELF && u==v) continue;
+    // With a single label, belonging coefficient is always 1 (as in LPA).
+    if (L==1) { copraAccumulateCud(hk, hv, H, comk[v], w); continue; }
+    for (size_t j=0; j<L; ++j) {
+      K c = comk[size_t(v)*L + j];
+      V b = comb[size_t(v)*L + j];
+      if (!b) break;
+      copraAccumulateCud(hk, hv, H, c, w*b);
+    }
+  }
+}
+
+
+/**
+ * Find the best community in a thread's share of a scan, which is worse than a given community.
+ * @param bk best community (output, or -1)
+ * @param bw total edge weight to best community (output)
+ * @param hk community of each slot
+ * @param hv total edge weight to community of each slot
+ * @param H number of slots
+ * @param u given vertex
+ * @param pk previous community (or -1 for none)
+ * @param pw total edge weight to previous community
+ * @param r tie-breaking salt (see copraTieSalt())
+ * @param t thread index in group
+ * @param T number of threads in group
+ */
+template <class K, class V>
+__device__ inline void copraBestScanCud(K& bk, V& bw, const K *hk, const V *hv, size_t H, K u, K pk, V pw, uint64_t r, size_t t, size_t T) {
+  bk = K(-1); bw = V();
+  for (size_t i=t; i<H; i+=T) {
+    K c = hk[i];
+    V w = hv[i];
+    if (c<K()) continue;
+    if (pk>=K() && !copraBetterLabelCud(u, pk, pw, c, w, r)) continue;
+    if (copraBetterLabelCud(u, c, w, bk, bw, r)) { bk = c; bw = w; }
+  }
+}
+
+
+/**
+ * Reduce best community across a warp.
+ * @param bk best community of this thread (updated, to that of the warp)
+ * @param bw total edge weight to best community (updated)
+ * @param u given vertex
+ * @param r tie-breaking salt (see copraTieSalt())
+ */
+template <class K, class V>
+__device__ inline void copraBestWarpCud(K& bk, V& bw, K u, uint64_t r) {
+  for (int s=16; s>0; s/=2) {
+    K ck = __shfl_down_sync(0xFFFFFFFF, bk, s);
+    V cw = __shfl_down_sync(0xFFFFFFFF, bw, s);
+    if (copraBetterLabelCud(u, ck, cw, bk, bw, r)) { bk = ck; bw = cw; }
+  }
+  bk = __shfl_sync(0xFFFFFFFF, bk, 0);
+  bw = __shfl_sync(0xFFFFFFFF, bw, 0);
+}
+
+
+/**
+ * Reduce best community across a block.
+ * @param bk best community of this thread (updated, to that of the block)
+ * @param bw total edge weight to best community (updated)
+ * @param bks best community of each warp (scratch, shared)
+ * @param bws total edge weight to best community of each warp (scratch, shared)
+ * @param u given vertex
+ * @param r tie-breaking salt (see copraTieSalt())
+ */
+template <class K, class V>
+__device__ inline void copraBestBlockCud(K& bk, V& bw, K *bks, V *bws, K u, uint64_t r) {
+  size_t t = threadIdx.x % 32, b = threadIdx.x / 32, B = blockDim.x / 32;
+  copraBestWarpCud(bk, bw, u, r);
+  if (t==0) { bks[b] = bk; bws[b] = bw; }
+  __syncthreads();
+  // Each warp reduces the same values, so the result need not be broadcast.
+  bk = t<B? bks[t] : K(-1);
+  bw = t<B? bws[t] : V();
+  copraBestWarpCud(bk, bw, u, r);
+  __syncthreads();
+}
+
+
+
+
+// COPRA-CUDA-CHOOSE-COMMUNITY
+// ---------------------------
+
+/**
+ * Choose connected communities with most weight, the same as copraSelectCommunity().
+ * Top labels are found one at a time, as the best label worse than the previous one.
+ * @param labk community of each chosen label (output, L)
+ * @param labw belonging coefficient of each chosen label (output, L)
+ * @param u given vertex
+ * @param W edge weight threshold above which communities are chosen
+ * @param fb find best community of group worse than given one (bk, bw, pk, pw)
+ * @returns number of chosen labels
+ */
+template <size_t L, class K, class V, class FB>
+__device__ inline size_t copraChooseCommunityCud(K *labk, V *labw, K u, V W, FB fb) {
+  size_t n = 0;
+  K pk = K(-1);
+  V pw = V();
+  // 1. Find the best label, which is all we need if it is below threshold.
+  // 2. Keep top labels above threshold, in order (bounded by L).
+  for (; n<L; ++n) {
+    K bk; V bw;
+    fb(bk, bw, pk, pw);
+    if (bk<K()) break;
+    if (n==0 && (L==1 || bw<W)) { labk[0] = bk; labw[0] = V(1); return 1; }
+    if (bw<W) break;
+    labk[n] = bk; labw[n] = bw;
+    pk = bk;  pw = bw;
+  }
+  if (n==0) { labk[0] = u; labw[0] = V(1); return 1; }
+  // 3. Normalize labels, such that belonging coefficient sums to 1.
+  V w = V();
+  for (size_t i=0; i<n; ++i)
+    w += labw[i];
+  for (size_t i=0; i<n; ++i)
+    labw[i] /= w;
+  return n;
+}
+
+
+/**
+ * Write community set of a vertex, and count it if its best community changed.
+ * @param outk community of each label of each vertex (updated)
+ * @param outw belonging coefficient of each label of each vertex (updated)
+ * @param changed number of vertices whose best community changed (updated)
+ * @param u given vertex
+ * @param d previous best community of vertex u
+ * @param labk community of each chosen label
+ * @param labw belonging coefficient of each chosen label
+ * @param n number of chosen labels
+ */
+template <size_t L, class K, class V>
+__device__ inline void copraWriteCommunityCud(K *outk, V *outw, K *changed, K u, K d, const K *labk, const V *labw, size_t n) {
+  for (size_t j=0; j<L; ++j) {
+    outk[size_t(u)*L + j] = j<n? labk[j] : K();
+    outw[size_t(u)*L + j] = j<n? labw[j] : V();
+  }
+  if (labk[0]!=d) atomicAdd(changed, K(1));
+}
+
+
+
+
+// COPRA-CUDA-MOVE-ITERATION
+// -------------------------
+// Output community sets are the input ones, when asynchronous.
+
+/**
+ * Move each low degree vertex to its best communities, with a warp per vertex.
+ * @param outk community of each label of each vertex, after this iteration (updated)
+ * @param outw belonging coefficient of each label of each vertex, after this iteration (updated)
+ * @param changed number of vertices whose best community changed (updated)
+ * @param comk community of each label of each vertex
+ * @param comb belonging coefficient of each label of each vertex
+ * @param xoff offsets of original graph (CSR)
+ * @param xedk edge keys of original graph (CSR)
+ * @param xedw edge values of original graph (CSR)
+ * @param vtot total edge weight of each vertex
+ * @param vlow low degree vertices
+ * @param NL number of low degree vertices
+ * @param B belonging coefficient threshold
+ * @param r tie-breaking salt of this iteration (see copraTieSalt())
+ */
+template <size_t L, class K, class V, class O>
+__global__ void copraMoveWarpCukW(K *outk, V *outw, K *changed, const K *comk, const V *comb, const O *xoff, const K *xedk, const V *xedw, const V *vtot, const K *vlow, K NL, V B, uint64_t r) {
+  constexpr size_t WARPS = COPRA_CUDA_WARP_BLOCK / 32;
+  constexpr size_t HS    = COPRA_CUDA_WARP_SLOTS;
+  __shared__ K hks[WARPS][HS];
+  __shared__ V hvs[WARPS][HS];
+  size_t t = threadIdx.x % 32, b = threadIdx.x / 32;
+  size_t I = (size_t(blockIdx.x) * blockDim.x + threadIdx.x) / 32;
+  size_t DI = size_t(gridDim.x) * blockDim.x / 32;
+  K *hk = hks[b];
+  V *hv = hvs[b];
+  for (size_t i=I; i<size_t(NL); i+=DI) {
+    K u = vlow[i];
+    K d = comk[size_t(u)*L];
+    size_t H = copraScanSlotsCud(size_t(xoff[u+1] - xoff[u]) * L);
+    copraClearScanCud(hk, hv, H, t, 32);
+    __syncwarp();
+    copraScanCommunitiesCud<L>(hk, hv, H, u, xoff, xedk, xedw, comk, comb, t, 32);
+    __syncwarp();
+    auto fb = [&](K& bk, V& bw, K pk, V pw) {
+      copraBestScanCud(bk, bw, hk, hv, H, u, pk, pw, r, t, 32);
+      copraBestWarpCud(bk, bw, u, r);
+    };
+    K labk[L]; V labw[L];
+    size_t n = copraChooseCommunityCud<L>(labk, labw, u, B*vtot[u], fb);
+    if (t==0) copraWriteCommunityCud<L>(outk, outw, changed, u, d, labk, labw, n);
+    __syncwarp();
+  }
+}
+
+
+/**
+ * Move each hub to its best communities, with a block per vertex.
+ * @param outk community of each label of each vertex, after this iteration (updated)
+ * @param outw belonging coefficient of each label of each vertex, after this iteration (updated)
+ * @param changed number of vertices whose best community changed (updated)
+ * @param comk community of each label of each vertex
+ * @param comb belonging coefficient of each label of each vertex
+ * @param xoff offsets of original graph (CSR)
+ * @param xedk edge keys of original graph (CSR)
+ * @param xedw edge values of original graph (CSR)
+ * @param vtot total edge weight of each vertex
+ * @param vhub hubs
+ * @param NH number of hubs
+ * @param gk community of each slot of global hash table of each block (scratch, if any hub does not fit in shared memory)
+ * @param gv total edge weight to community of each slot of global hash table of each block (scratch, if any hub does not fit in shared memory)
+ * @param HG number of slots of global hash table of each block
+ * @param S span of vertices
+ * @param B belonging coefficient threshold
+ * @param r tie-breaking salt of this iteration (see copraTieSalt())
+ */
+template <size_t L, class K, class V, class O>
+__global__ void copraMoveBlockCukW(K *outk, V *outw, K *changed, const K *comk, const V *comb, const O *xoff, const K *xedk, const V *xedw, const V *vtot, const K *vhub, K NH, K *gk, V *gv, size_t HG, K S, V B, uint64_t r) {
+  constexpr size_t HS = COPRA_CUDA_HUB_SLOTS;
+  __shared__ K hks[HS];
+  __shared__ V hvs[HS];
+  __shared__ K bks[32];
+  __shared__ V bws[32];
+  size_t t = threadIdx.x, T = blockDim.x;
+  for (size_t i=blockIdx.x; i<size_t(NH); i+=gridDim.x) {
+    K u = vhub[i];
+    K d = comk[size_t(u)*L];
+    size_t n = size_t(xoff[u+1] - xoff[u]) * L;
+    size_t H = copraScanSlotsCud(n < size_t(S)? n : size_t(S));
+    K *hk = H<=HS? hks : gk + blockIdx.x * HG;
+    V *hv = H<=HS? hvs : gv + blockIdx.x * HG;
+    copraClearScanCud(hk, hv, H, t, T);
+    __syncthreads();
+    copraScanCommunitiesCud<L>(hk, hv, H, u, xoff, xedk, xedw, comk, comb, t, T);
+    __syncthreads();
+    auto fb = [&](K& bk, V& bw, K pk, V pw) {
+      copraBestScanCud(bk, bw, hk, hv, H, u, pk, pw, r, t, T);
+      copraBestBlockCud(bk, bw, bks, bws, u, r);
+    };
+    K labk[L]; V labw[L];
+    n = copraChooseCommunityCud<L>(labk, labw, u, B*vtot[u], fb);
+    if (t==0) copraWriteCommunityCud<L>(outk, outw, changed, u, d, labk, labw, n);
+    __syncthreads();
+  }
+}
+
+
+
+
+// COPRA-CUDA
+// ----------
+
+/**
+ * Find overlapping communities using COPRA, on a GPU.
+ * Community sets are updated in place when asynchronous, so results depend on scheduling.
+ * Weights are accumulated in a different order than on the CPU, so ties may also differ.
+ * @param x original graph
+ * @param q initial community (vector<K>), or community set of each vertex, for warm-start (or null)
+ * @param o copra options (hubDegree = process vertices with a larger degree by a block; fullSort, hashScan, convergence, stableIterations, and computeModularity are ignored)
+ * @returns copra result
+ */
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, class G, class Q>
+auto copraCuda(const G& x, const Q* q=nullptr, const CopraOptions& o={}) {
+  using K = typename G::key_type;
+  using V = typename G::edge_value_type;
+  using O = size_t;
+  static_assert(is_signed<K>::value, "copraCuda() marks empty hash table slots with K(-1), so vertex keys must be signed");
+  const size_t L = LABELS;
+  int l = 0;
+  K S = x.span();
+  K N = x.order();
+  V B = copraThreshold<V>(o, L);
+  vector<V> vtot(S);
+  LabelsetVector<K, V, L> vcom(S);
+  // Flatten graph to CSR, and split vertices into low degree ones, hubs, and hubs
+  // whose scan does not fit in shared memory (big).
+  vector<O> xoff(S+1);
+  vector<K> xedk, vlow, vhub, vbig;
+  vector<V> xedw;
+  size_t dmax = 0;
+  for (K u=0; u<S; ++u) {
+    xoff[u] = xedk.size();
+    if (!x.hasVertex(u)) continue;
+    x.forEachEdge(u, [&](auto v, auto w) { xedk.push_back(v); xedw.push_back(w); });
+    size_t d = x.degree(u);
+    bool hub = (o.hubDegree>0 && d>size_t(o.hubDegree)) || copraScanSlotsCud(d*L) > COPRA_CUDA_WARP_SLOTS;
+    bool big = copraScanSlotsCud(min(d*L, size_t(S))) > COPRA_CUDA_HUB_SLOTS;
+    if (big) { vbig.push_back(u); dmax = max(dmax, d); }
+    else if (hub) vhub.push_back(u);
+    else vlow.push_back(u);
+  }
+  xoff[S] = xedk.size();
+  K NL = vlow.size(), NH = vhub.size(), NB = vbig.size();
+  int GL = int(min(ceilDiv(size_t(NL)*32, size_t(COPRA_CUDA_WARP_BLOCK)), size_t(COPRA_CUDA_GRID)));
+  int GH = int(min(size_t(NH), size_t(COPRA_CUDA_HUB_GRID)));
+  int GB = int(min(size_t(NB), size_t(COPRA_CUDA_BIG_GRID)));
+  // Global tables are sized for the largest big hub, for each block of the small grid.
+  size_t HG = NB>0? copraScanSlotsCud(min(dmax*L, size_t(S))) : 0;
+  // Copy graph to device, and allocate community sets.
+  O *dxoff = allocateCuda<O>(S+1);
+  K *dxedk = allocateCuda<K>(xedk.size());
+  V *dxedw = allocateCuda<V>(xedw.size());
+  K *dvlow = allocateCuda<K>(NL);
+  K *dvhub = allocateCuda<K>(NH);
+  K *dvbig = allocateCuda<K>(NB);
+  V *dvtot = allocateCuda<V>(S);
+  K *dcomk = allocateCuda<K>(S*L), *dconk = o.synchronous? allocateCuda<K>(S*L) : nullptr;
+  V *dcomb = allocateCuda<V>(S*L), *dconb = o.synchronous? allocateCuda<V>(S*L) : nullptr;
+  K *dgk   = allocateCuda<K>(GB*HG);
+  V *dgv   = allocateCuda<V>(GB*HG);
+  K *dn    = allocateCuda<K>(1);
+  copyToCuda(dxoff, xoff);
+  copyToCuda(dxedk, xedk);
+  copyToCuda(dxedw, xedw);
+  copyToCuda(dvlow, vlow);
+  copyToCuda(dvhub, vhub);
+  copyToCuda(dvbig, vbig);
+  vector<K> comk(S*L);
+  vector<V> comb(S*L);
+  auto fs = [&]() {
+    for (K u=0; u<S; ++u)
+      for (size_t j=0; j<L; ++j) {
+        comk[size_t(u)*L + j] = vcom[u][j].first;
+        comb[size_t(u)*L + j] = vcom[u][j].second;
+      }
+  };
+  float ts = 0;
+  float t = measureDuration([&]() {
+    auto t0 = timeNow();
+    copraVertexWeightsOmp(vtot, x);
+    if (q) copraInitializeFromOmp(vcom, x, *q);
+    else   copraInitializeOmp(vcom, x);
+    fs();
+    copyToCuda(dvtot, vtot);
+    copyToCuda(dcomk, comk);
+    copyToCuda(dcomb, comb);
+    if (o.synchronous) { copyToCuda(dconk, comk); copyToCuda(dconb, comb); }
+    ts += durationMilliseconds(t0, timeNow());
+    for (l=0; l<o.maxIterations;) {
+      uint64_t r = copraTieSalt(o.seed, l);
+      K n = K();
+      K *doutk = o.synchronous? dconk : dcomk;
+      V *doutb = o.synchronous? dconb : dcomb;
+      TRY_CUDA(cudaMemset(dn, 0, sizeof(K)));
+      if (NL>0) copraMoveWarpCukW<L><<<GL, COPRA_CUDA_WARP_BLOCK>>>(doutk, doutb, dn, dcomk, dcomb, dxoff, dxedk, dxedw, dvtot, dvlow, NL, B, r);
+      if (NH>0) copraMoveBlockCukW<L><<<GH, COPRA_CUDA_HUB_BLOCK>>>(doutk, doutb, dn, dcomk, dcomb, dxoff, dxedk, dxedw, dvtot, dvhub, NH, (K*) nullptr, (V*) nullptr, 0, S, B, r);
+      if (NB>0) copraMoveBlockCukW<L><<<GB, COPRA_CUDA_HUB_BLOCK>>>(doutk, doutb, dn, dcomk, dcomb, dxoff, dxedk, dxedw, dvtot, dvbig, NB, dgk, dgv, HG, S, B, r);
+      TRY_CUDA(cudaGetLastError());
+      TRY_CUDA(cudaMemcpy(&n, dn, sizeof(K), cudaMemcpyDeviceToHost));
+      ++l;
+      if (o.synchronous) { swap(dcomk, dconk); swap(dcomb, dconb); }
+      PRINTFD("copraCuda(): l=%d, n=%d, N=%d, n/N=%f\n", l, n, N, float(n)/N);
+      if (float(n)/N <= o.tolerance) break;
+    }
+  }, o.repeat);
+  // Copy community sets back to host.
+  copyFromCuda(comk, dcomk);
+  copyFromCuda(comb, dcomb);
+  for (K u=0; u<S; ++u)
+    for (size_t j=0; j<L; ++j)
+      vcom[u][j] = {comk[size_t(u)*L + j], comb[size_t(u)*L + j]};
+  freeCuda(dxoff); freeCuda(dxedk); freeCuda(dxedw);
+  freeCuda(dvlow); freeCuda(dvhub); freeCuda(dvbig); freeCuda(dvtot);
+  freeCuda(dcomk); freeCuda(dconk); freeCuda(dcomb); freeCuda(dconb);
+  freeCuda(dgk);   freeCuda(dgv);   freeCuda(dn);
+  vector<size_t> aoff;
+  vector<pair<K, V>> alab;
+  if (o.saveLabelsets) copraCompactLabelsetsW(aoff, alab, vcom);
+  CopraResult<K, V> a(copraBestCommunities(vcom), move(aoff), move(alab), l, t);
+  a.setupTime = ts / o.repeat;
+  return a;
+}
+
+
+/**
+ * Find overlapping communities using COPRA, on a GPU, with labels per vertex chosen at runtime.
+ * @param x original graph
+ * @param q initial community (vector<K>), or community set of each vertex, for warm-start (or null)
+ * @param o copra options (maxLabels = labels per vertex, or 0 for COPRA_MAX_MEMBERSHIP)
+ * @returns copra result
+ */
+template <class G, class Q>
+inline auto copraCudaLabels(const G& x, const Q* q=nullptr, const CopraOptions& o={}) {
+  size_t maxLabels = o.maxLabels>0? o.maxLabels : COPRA_MAX_MEMBERSHIP;
+  return copraDispatchLabels(maxLabels, [&](auto L) { return copraCuda<decltype(L)::value>(x, q, o); });
+}
@@ -0,0 +1,379 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <climits>
+#include <utility>
+#include <type_traits>
+#include <vector>
+#include <algorithm>
+#include <mpi.h>
+#include "_main.hxx"
+#include "bin.hxx"
+#include "copra.hxx"
+#include "copraSeq.hxx"
+
+using std::vector;
+using std::swap;
+using std::sort;
+using std::unique;
+using std::upper_bound;
+using std::min;
+using std::max;
+using std::move;
+using std::is_same;
+using std::is_arithmetic;
+
+
+
+
+// COPRA-MPI-LABELSETS
+// -------------------
+// Community sets of owned vertices, and ghost copies of their neighbors on other ranks.
+// They are indexed by global vertex id, through a slot of each vertex, so that the
+// move kernels (and their tie-breaking) see the same ids as on a single node.
+
+template <class M, class K>
+class CopraGhostLabelsets {
+  // Data.
+  public:
+  M data;                                // community set of each slot (owned, then ghosts)
+  const vector<K> *slots = nullptr;      // slot of each vertex (only owned and ghosts are valid)
+
+  // Types.
+  public:
+  using value_type = LabelsetOf<M>;
+
+  // Access operations.
+  public:
+  inline size_t size() const noexcept { return data.size(); }
+  inline decltype(auto) operator[](size_t u) const noexcept { return data[(*slots)[u]]; }
+  inline decltype(auto) operator[](size_t u)       noexcept { return data[(*slots)[u]]; }
+
+  // Lifetime operations.
+  public:
+  CopraGhostLabelsets() = default;
+  CopraGhostLabelsets(size_t n, const vector<K>& slots) : data(n), slots(&slots) {}
+};
+
+
+// Changed community set of an owned vertex, sent to ranks with a ghost copy.
+template <class K, class A>
+struct CopraGhostUpdate {
+  K u;
+  A labs;
+};
+
+
+
+
+// COPRA-MPI-TYPE
+// --------------
+// Counts and displacements are passed to MPI as elements (not bytes), so that
+// they only overflow an int beyond 2^31 elements.
+
+/**
+ * Get MPI datatype of a value type.
+ * Values other than integers and floats are sent as a contiguous block of bytes.
+ * @returns datatype (free with copraMpiFreeType())
+ */
+template <class T>
+inline MPI_Datatype copraMpiType() {
+  if constexpr (is_same<T, int32_t>::value)  return MPI_INT32_T;
+  else if constexpr (is_same<T, int64_t>::value)  return MPI_INT64_T;
+  else if constexpr (is_same<T, uint32_t>::value) return MPI_UINT32_T;
+  else if constexpr (is_same<T, uint64_t>::value) return MPI_UINT64_T;
+  else if constexpr (is_same<T, float>::value)    return MPI_FLOAT;
+  else if constexpr (is_same<T, double>::value)   return MPI_DOUBLE;
+  else {
+    MPI_Datatype a;
+    MPI_Type_contiguous(int(sizeof(T)), MPI_BYTE, &a);
+    MPI_Type_commit(&a);
+    return a;
+  }
+}
+
+
+/**
+ * Free MPI datatype of a value type, if it was created by copraMpiType().
+ * @param a datatype (updated)
+ */
+template <class T>
+inline void copraMpiFreeType(MPI_Datatype& a) {
+  if constexpr (!is_arithmetic<T>::value) MPI_Type_free(&a);
+}
+
+
+
+
+// COPRA-MPI-EXCHANGE
+// ------------------
+
+/**
+ * Exchange values with all ranks.
+ * Aborts if more than INT_MAX values are sent, or received.
+ * @param a received values, grouped by source rank (output)
+ * @param ra number of values received from each rank (output)
+ * @param x values to send, grouped by target rank
+ * @param rx number of values to send to each rank
+ * @param comm communicator
+ * @returns number of bytes sent
+ */
+template <class T>
+size_t copraMpiAlltoallvW(vector<T>& a, vector<int>& ra, const vector<T>& x, const vector<int>& rx, MPI_Comm comm) {
+  int P = rx.size();
+  vector<int> so(P), ro(P);
+  ra.resize(P);
+  MPI_Alltoall(rx.data(), 1, MPI_INT, ra.data(), 1, MPI_INT, comm);
+  size_t sb = 0, rb = 0;
+  for (int r=0; r<P; ++r) {
+    so[r] = int(min(sb, size_t(INT_MAX))); sb += rx[r];
+    ro[r] = int(min(rb, size_t(INT_MAX))); rb += ra[r];
+  }
+  if (sb > size_t(INT_MAX) || rb > size_t(INT_MAX)) {
+    fprintf(stderr, "copraMpiAlltoallvW(): cannot exchange more than INT_MAX values (sent=%zu, received=%zu)\n", sb, rb);
+    MPI_Abort(comm, 1);
+  }
+  a.resize(rb);
+  MPI_Datatype t = copraMpiType<T>();
+  MPI_Alltoallv(x.data(), rx.data(), so.data(), t, a.data(), ra.data(), ro.data(), t, comm);
+  copraMpiFreeType<T>(t);
+  return sb * sizeof(T);
+}
+
+
+/**
+ * Split vertices across ranks, into contiguous ranges with about the same number of edges.
+ * @param s binary snapshot stream
+ * @param P number of ranks
+ * @returns first vertex of each rank, followed by span
+ */
+template <class K, class E, class O>
+vector<K> copraMpiRanges(const BinStream<K, E, O>& s, int P) {
+  K S = s.span();
+  size_t M = s.size();
+  vector<K> a(P+1);
+  a[P] = S;
+  for (int r=1; r<P; ++r) {
+    size_t m = M * r / P;
+    K lo = a[r-1], hi = S;
+    while (lo<hi) {
+      K mid = lo + (hi-lo)/2;
+      if (size_t(s.offset(mid)) < m) lo = mid+1;
+      else hi = mid;
+    }
+    a[r] = lo;
+  }
+  return a;
+}
+
+
+
+
+// COPRA-MPI-RESULT
+// ----------------
+
+struct CopraMpiStats {
+  int    ranks = 1;
+  size_t ghosts = 0;         // ghost vertices, on all ranks
+  size_t boundary = 0;       // (vertex, rank) pairs to send changed community sets to
+  size_t bytesSent = 0;      // bytes of community sets sent, on all ranks
+  size_t rounds = 0;         // exchange rounds, on all iterations (with bounded batches)
+  float  loadTime = 0;       // time to read partition and find ghosts (ms, max over ranks)
+  float  computeTime = 0;    // time spent in move iterations (ms, max over ranks)
+  float  exchangeTime = 0;   // time spent exchanging community sets and counts (ms, max over ranks)
+};
+
+
+template <class K, class V=float>
+struct CopraMpiResult {
+  CopraResult<K, V> result;  // membership only on root rank
+  CopraMpiStats stats;       // per repeat, only on root rank
+  double modularity = 0;     // modularity of best community of each vertex, only on root rank
+};
+
+
+
+
+// COPRA-MPI
+// ---------
+// Each rank owns a contiguous range of vertices, and reads only their edges.
+// After each move iteration, changed community sets of boundary vertices are
+// sent to ranks with a ghost copy, in rounds of at most a batch per rank.
+
+/**
+ * Find overlapping communities using COPRA, across ranks of a communicator.
+ * With synchronous updates, results are the same as copraSeqStatic().
+ * Memory per rank is that of owned edges, community sets of owned and ghost
+ * vertices, and a few arrays of span size (vertex weights, slots, and dense scans).
+ * @param s binary snapshot stream (on each rank)
+ * @param o copra options (convergence, stableIterations, and saveLabelsets are ignored)
+ * @param batch maximum community sets sent to a rank in an exchange round
+ * @param comm communicator
+ * @returns copra result (membership on root rank), and exchange statistics
+ */
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, class K, class E, class O>
+auto copraMpi(const BinStream<K, E, O>& s, const CopraOptions& o, size_t batch=size_t(1)<<16, MPI_Comm comm=MPI_COMM_WORLD) {
+  using V = E;
+  using M = CopraGhostLabelsets<LABELSETS<K, V, LABELS>, K>;
+  using A = LabelsetOf<M>;
+  using U = CopraGhostUpdate<K, A>;
+  const size_t L = LABELS;
+  int R = 0, P = 1, l = 0;
+  MPI_Comm_rank(comm, &R);
+  MPI_Comm_size(comm, &P);
+  K S = s.span();
+  K N = s.order();
+  V B = copraThreshold<V>(o, L);
+  batch = max(batch, size_t(1));
+  CopraMpiStats st;
+  st.ranks = P;
+  // Read owned vertices, and find ghosts (neighbors owned by other ranks).
+  auto t0 = timeNow();
+  auto vr = copraMpiRanges(s, P);
+  K ub = vr[R], ue = vr[R+1], n = ue - ub;
+  BinPartition<K, E, O> x;
+  s.readPartitionW(x, ub, ue);
+  vector<K> vghost, vslot(S);
+  x.forEachVertexKey([&](auto u) {
+    x.forEachEdgeKey(u, [&](auto v) { if (v<ub || v>=ue) vghost.push_back(v); });
+  });
+  sort(vghost.begin(), vghost.end());
+  vghost.erase(unique(vghost.begin(), vghost.end()), vghost.end());
+  for (K u=ub; u<ue; ++u)
+    vslot[u] = u - ub;
+  for (size_t i=0; i<vghost.size(); ++i)
+    vslot[vghost[i]] = K(n + i);
+  // Ask owners for ghosts, to find which owned vertices each rank needs.
+  vector<int> gc(P), sc;
+  for (K v : vghost)
+    ++gc[upper_bound(vr.begin(), vr.end(), v) - vr.begin() - 1];
+  vector<K> vsend;
+  copraMpiAlltoallvW(vsend, sc, vghost, gc, comm);
+  vector<size_t> vsoff(P+1);
+  for (int r=0; r<P; ++r)
+    vsoff[r+1] = vsoff[r] + sc[r];
+  st.loadTime = durationMilliseconds(t0, timeNow());
+  st.ghosts   = vghost.size();
+  st.boundary = vsend.size();
+  // Buffers for move iterations.
+  size_t ns = n + vghost.size();
+  vector<K> vcs;
+  vector<V> vcout(o.hashScan? 0 : S), vtot(S);
+  CopraScanTable<K, V> vtab;
+  M vcom(ns, vslot), vcon(o.synchronous? ns : 0, vslot);
+  vector<char> vchanged(n);
+  vector<U> vbuf, vrecv;
+  vector<int> rb(P), rr;
+  vector<size_t> vi(P);
+  CopraIterationTrace tr;
+  auto fa = [](auto u) { return true; };
+  auto fp = [](auto u) {};
+  auto fc = [&](auto u, const auto& labs, const auto& b) {
+    A labn = b;
+    if (!(labs==labn)) vchanged[u-ub] = 1;
+  };
+  // Send changed community sets to ranks with a ghost copy, in bounded batches.
+  auto fx = [&]() {
+    fillValueU(vi, size_t());
+    for (int more=1; more;) {
+      vbuf.clear();
+      int local = 0;
+      for (int r=0; r<P; ++r) {
+        size_t i = vsoff[r] + vi[r], ie = vsoff[r+1], b0 = vbuf.size();
+        for (; i<ie && vbuf.size()-b0 < batch; ++i) {
+          K u = vsend[i];
+          if (vchanged[u-ub]) vbuf.push_back({u, A(vcom[u])});
+        }
+        vi[r] = i - vsoff[r];
+        rb[r] = int(vbuf.size() - b0);
+        if (i<ie) local = 1;
+      }
+      st.bytesSent += copraMpiAlltoallvW(vrecv, rr, vbuf, rb, comm);
+      for (const auto& [u, labs] : vrecv) {
+        vcom[u] = labs;
+        if (o.synchronous) vcon[u] = labs;
+      }
+      ++st.rounds;
+      MPI_Allreduce(&local, &more, 1, MPI_INT, MPI_MAX, comm);
+    }
+  };
+  float ts = 0;
+  float t = measureDuration([&]() {
+    MPI_Barrier(comm);
+    auto t1 = timeNow();
+    copraVertexWeights(vtot, x);
+    copraInitialize(vcom, x);
+    for (K v : vghost)
+      vcom[v] = {make_pair(v, V(1))};
+    if (o.synchronous) vcon.data = vcom.data;
+    ts += durationMilliseconds(t1, timeNow());
+    for (l=0; l<o.maxIterations;) {
+      uint64_t r = copraTieSalt(o.seed, l);
+      fillValueU(vchanged, char());
+      auto t2 = timeNow();
+      auto fi = [&](auto& vcon, auto& vcout) {
+        return o.fullSort?
+          copraMoveIteration<true> (vcs, vcout, vcon, vcom, x, vtot, B, r, fa, fp, fc, tr) :
+          copraMoveIteration<false>(vcs, vcout, vcon, vcom, x, vtot, B, r, fa, fp, fc, tr);
+      };
+      auto fj = [&](auto& vcout) { return o.synchronous? fi(vcon, vcout) : fi(vcom, vcout); };
+      K m = o.hashScan? fj(vtab) : fj(vcout), mt = K(); ++l;
+      if (o.synchronous) swap(vcom.data, vcon.data);
+      auto t3 = timeNow();
+      fx();
+      MPI_Allreduce(&m, &mt, 1, copraMpiType<K>(), MPI_SUM, comm);
+      st.computeTime  += durationMilliseconds(t2, t3);
+      st.exchangeTime += durationMilliseconds(t3, timeNow());
+      if (R==0) PRINTFD("copraMpi(): l=%d, n=%d, N=%d, n/N=%f\n", l, mt, N, float(mt)/N);
+      if (float(mt)/N <= o.tolerance) break;
+    }
+    MPI_Barrier(comm);
+  }, o.repeat);
+  // Gather best community of each vertex on root rank.
+  vector<K> vbest(n), a;
+  for (K u=ub; u<ue; ++u)
+    vbest[u-ub] = vcom[u][0].first;
+  vector<int> vc(P), vo(P);
+  for (int r=0; r<P; ++r) {
+    vc[r] = int(vr[r+1] - vr[r]);
+    vo[r] = int(vr[r]);
+  }
+  if (R==0) a.resize(S);
+  MPI_Gatherv(vbest.data(), int(n), copraMpiType<K>(), a.data(), vc.data(), vo.data(), copraMpiType<K>(), 0, comm);
+  // Find modularity of best communities, as ghost copies are up to date.
+  vector<double> ctot(S), ctotr(R==0? S : 0);
+  double qv[2] = {0, 0}, qa[2] = {0, 0};
+  x.forEachVertexKey([&](auto u) {
+    K c = vcom[u][0].first;
+    x.forEachEdge(u, [&](auto v, auto w) {
+      if (vcom[v][0].first==c) qv[0] += w;
+      ctot[c] += w;
+      qv[1] += w;
+    });
+  });
+  MPI_Reduce(ctot.data(), ctotr.data(), int(S), MPI_DOUBLE, MPI_SUM, 0, comm);
+  MPI_Reduce(qv, qa, 2, MPI_DOUBLE, MPI_SUM, 0, comm);
+  double q = 0;
+  if (R==0 && qa[1]>0) {
+    q = qa[0] / qa[1];
+    for (double c : ctotr)
+      q -= (c / qa[1]) * (c / qa[1]);
+  }
+  // Reduce statistics on root rank.
+  unsigned long long sv[4] = {st.ghosts, st.boundary, st.bytesSent, st.rounds}, sa[4];
+  float tv[3] = {st.loadTime, st.computeTime / o.repeat, st.exchangeTime / o.repeat}, ta[3];
+  MPI_Reduce(sv, sa, 4, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, comm);
+  MPI_Reduce(tv, ta, 3, MPI_FLOAT, MPI_MAX, 0, comm);
+  if (R==0) {
+    st.ghosts   = sa[0];
+    st.boundary = sa[1];
+    st.bytesSent = sa[2] / o.repeat;
+    st.rounds    = sa[3] / P / o.repeat;
+    st.loadTime  = ta[0];
+    st.computeTime  = ta[1];
+    st.exchangeTime = ta[2];
+  }
+  CopraResult<K, V> b(move(a), l, t);
+  b.setupTime = ts / o.repeat;
+  return CopraMpiResult<K, V> {move(b), st, q};
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+#include "_main.hxx"
+#include "modularity.hxx"
+#include "copra.hxx"
+#include "copraSeq.hxx"
+
+using std::vector;
+using std::move;
+using std::swap;
+using std::max;
+
+
+
+
+// COPRA-MULTI-RESULT
+// ------------------
+
+template <class K, class V=float>
+struct CopraMultiResult {
+  CopraResult<K, V> best;      // run with the highest modularity
+  int    bestRun = 0;          // index of best run (seed = first seed + index)
+  vector<double> modularities; // modularity of best community of each vertex, for each run
+  vector<K> consensus;         // consensus membership (only if requested)
+  float  time = 0;             // total time, including consensus (ms)
+  float  consensusTime = 0;    // time to find consensus (ms)
+
+  CopraMultiResult(CopraResult<K, V>&& best) : best(move(best)) {}
+};
+
+
+
+
+// COPRA-CONSENSUS
+// ---------------
+// Vertices are in the same consensus community if they are linked by a path of
+// edges whose endpoints share a best community in more than half of the runs.
+
+/**
+ * Find consensus membership of independent runs.
+ * @param a consensus membership (output)
+ * @param x original graph
+ * @param ms membership of each run
+ */
+template <class G, class K>
+void copraConsensusW(vector<K>& a, const G& x, const vector<vector<K>>& ms) {
+  K S = x.span();
+  size_t R = ms.size();
+  vector<K> vq;
+  vector<bool> vis(S);
+  a.assign(S, K());
+  auto fk = [&](K u, K v) {
+    size_t n = 0;
+    for (const auto& m : ms)
+      if (m[u]==m[v]) ++n;
+    return 2*n > R;
+  };
+  x.forEachVertexKey([&](auto s) {
+    if (vis[s]) return;
+    vis[s] = true;
+    vq.clear();
+    vq.push_back(s);
+    for (size_t i=0; i<vq.size(); ++i) {
+      K u = vq[i];
+      a[u] = s;
+      x.forEachEdgeKey(u, [&](auto v) {
+        if (vis[v] || !fk(u, v)) return;
+        vis[v] = true;
+        vq.push_back(v);
+      });
+    }
+  });
+}
+
+
+
+
+// COPRA-MULTI-START
+// -----------------
+// Independent seeded runs share the graph, and vertex weights (read-only).
+// Each thread reuses its own workspace, and keeps only the result of its best
+// run; memberships of all runs are kept only for consensus.
+
+/**
+ * Find overlapping communities using multiple independent seeded runs of COPRA, in parallel.
+ * @param x original graph
+ * @param o copra options (repeat is ignored)
+ * @param runs number of runs
+ * @param seed seed of first run (run i uses seed + i, for initial communities and ties, see copraInitializeSeeded())
+ * @param consensus find consensus membership of all runs?
+ * @returns best run by modularity, and consensus membership
+ */
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, class G>
+auto copraMultiStartOmp(const G& x, const CopraOptions& o, int runs, uint64_t seed=0, bool consensus=false) {
+  using K = typename G::key_type;
+  using V = typename G::edge_value_type;
+  using W = CopraWorkspace<K, V, LABELSETS<K, V, LABELS>>;
+  int T = omp_get_max_threads();
+  K S = x.span();
+  vector<V> vtot(S);
+  vector<W*> ws(T);
+  vector<vector<K>> ms(runs);
+  vector<double> qs(runs);
+  vector<CopraResult<K, V>> as(T, CopraResult<K, V>(vector<K>()));
+  vector<int> bs(T, -1);
+  CopraOptions p = o;
+  p.repeat = 1;
+  float tc = 0;
+  auto t0 = timeNow();
+  copraVertexWeightsOmp(vtot, x);
+  double M = 0;
+  for (V w : vtot)
+    M += w;
+  M /= 2;
+  for (int t=0; t<T; ++t)
+    ws[t] = new W();
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (int i=0; i<runs; ++i) {
+    int t = omp_get_thread_num();
+    W& w = *ws[t];
+    w.sharedWeights = &vtot;
+    w.resizeLabelsets(S, p.synchronous);
+    CopraOptions q = p;
+    q.seed = seed + i;
+    copraInitializeSeeded(w.vcom, x, q.seed);
+    auto a = copraSeqW(w, x, &w.vcom, q);
+    auto fc = [&](auto u) { return a.membership[u]; };
+    qs[i] = modularityBy(x, fc, M, 1.0);
+    // Keep only the best run of each thread, and memberships if needed for consensus.
+    if (consensus) ms[i] = a.membership;
+    if (bs[t]<0 || qs[i] > qs[bs[t]]) { bs[t] = i; as[t] = move(a); }
+  }
+  for (int t=0; t<T; ++t)
+    delete ws[t];
+  int b = 0;
+  for (int t=1; t<T; ++t)
+    if (bs[t]>=0 && (bs[b]<0 || qs[bs[t]] > qs[bs[b]] || (qs[bs[t]]==qs[bs[b]] && bs[t] < bs[b]))) b = t;
+  CopraMultiResult<K, V> a(move(as[b]));
+  a.bestRun = max(bs[b], 0);
+  a.modularities = move(qs);
+  if (consensus && runs>0) tc = measureDuration([&]() { copraConsensusW(a.consensus, x, ms); });
+  a.consensusTime = tc;
+  a.time = durationMilliseconds(t0, timeNow());
+  return a;
+}
@@ -0,0 +1,728 @@
+#pragma once
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+#include "_main.hxx"
+#include "vertices.hxx"
+#include "edges.hxx"
+#include "csr.hxx"
+#include "copra.hxx"
+
+using std::pair;
+using std::tuple;
+using std::vector;
+using std::make_pair;
+using std::swap;
+using std::sort;
+using std::min;
+using std::move;
+using std::copy;
+
+
+
+
+// COPRA-ALLOCATE/FREE-SCANS
+// -------------------------
+
+/**
+ * Allocate per-thread community scan data.
+ * @param vcs communities vertex u is linked to, for each thread (updated)
+ * @param vcout total edge weight from vertex u to community C, for each thread (updated)
+ * @param S span of graph
+ */
+template <class K, class V>
+inline void copraAllocateScansW(vector<vector<K>*>& vcs, vector<vector<V>*>& vcout, size_t S) {
+  size_t T = vcs.size();
+  for (size_t t=0; t<T; ++t) {
+    vcs[t]   = new vector<K>();
+    vcout[t] = new vector<V>(S);
+  }
+}
+
+
+/**
+ * Free per-thread community scan data.
+ * @param vcs communities vertex u is linked to, for each thread (updated)
+ * @param vcout total edge weight from vertex u to community C, for each thread (updated)
+ */
+template <class K, class V>
+inline void copraFreeScansW(vector<vector<K>*>& vcs, vector<vector<V>*>& vcout) {
+  size_t T = vcs.size();
+  for (size_t t=0; t<T; ++t) {
+    delete vcs[t];
+    delete vcout[t];
+  }
+}
+
+
+
+
+// COPRA-MOVE-HUBS
+// ---------------
+// Scans of vertices with a large degree (hubs) are split into chunks of
+// COPRA_HUB_CHUNK edges, which are scanned by any thread. The labels of each
+// chunk are then merged in chunk order (in double), by one thread per hub.
+// Otherwise a single thread would be left scanning a hub, while others wait.
+// Chunks do not depend on the number of threads, so neither do the results
+// of synchronous runs. Hubs are processed in batches of at least
+// COPRA_HUB_BATCH edges, with two barriers per batch. As a hub needs at least
+// two chunks to be split, the hub degree is raised to at least COPRA_HUB_CHUNK.
+
+// Number of edges of a hub scanned as one chunk.
+#define COPRA_HUB_CHUNK 4096
+// Minimum number of hub edges scanned in one batch.
+#define COPRA_HUB_BATCH (1 << 20)
+
+
+/**
+ * Find the degree above which a vertex is a hub.
+ * @param D hub degree option (0 = no hubs)
+ * @returns hub degree, at least COPRA_HUB_CHUNK (0 = no hubs)
+ */
+template <class K>
+inline K copraHubDegree(int D) {
+  return D<=0? K() : max(K(D), K(COPRA_HUB_CHUNK));
+}
+
+
+/**
+ * Find vertices whose scans are split across threads.
+ * @param a hub vertices (output)
+ * @param x original graph
+ * @param D degree above which a vertex is a hub (0 = no hubs)
+ */
+template <class G, class K>
+inline void copraHubVerticesW(vector<K>& a, const G& x, K D) {
+  a.clear();
+  if (D<=K()) return;
+  x.forEachVertexKey([&](auto u) { if (x.degree(u) > D) a.push_back(u); });
+}
+
+
+/**
+ * Move each hub vertex to its best community, splitting its scan across threads.
+ * @param vcs communities vertex u is linked to, for each thread (updated)
+ * @param vcout total edge weight from vertex u to community C, as an array or CopraScanTable, for each thread (updated)
+ * @param vhs labels scanned from each chunk of hub edges, by each thread (updated)
+ * @param vht merged labels of a hub, for each thread (updated)
+ * @param vcon community set each vertex belongs to, after this iteration (updated)
+ * @param vcom community set each vertex belongs to (same as vcon, if asynchronous)
+ * @param x original graph (CSR)
+ * @param hubs hub vertices
+ * @param vtot total edge weight of each vertex
+ * @param B belonging coefficient threshold
+ * @param r tie-breaking salt of this iteration (see copraTieSalt())
+ * @param fa is vertex affected? (u)
+ * @param fp called with each vertex whose best community changed (u)
+ * @param fc called with each processed vertex, and its community set before and after (u, labs, labn)
+ * @param tr iteration trace (updated, if TRACE)
+ * @returns number of changed hub vertices
+ */
+template <bool SORT=false, bool TRACE=false, bool UNWEIGHTED=false, bool SELF=false, class G, class K, class C, class V, class M, class FA, class FP, class FC>
+K copraMoveHubsOmp(vector<vector<K>*>& vcs, vector<C*>& vcout, vector<vector<pair<K, V>>*>& vhs, vector<CopraScanTable<K, double>*>& vht, M& vcon, const M& vcom, const G& x, const vector<K>& hubs, const vector<V>& vtot, V B, uint64_t r, FA fa, FP fp, FC fc, CopraIterationTrace& tr) {
+  constexpr size_t L = tuple_size<LabelsetOf<M>>::value;
+  constexpr size_t E = COPRA_HUB_CHUNK;
+  K a = K();
+  size_t S = x.span();
+  size_t np = 0, ne = 0;
+  double ts = 0, tt = 0, tc = 0;
+  // Find affected hubs, the first chunk of each, and the first hub of each batch.
+  vector<K> us;
+  vector<size_t> ucs = {0}, ubs = {0};
+  size_t nb = 0;
+  for (K u : hubs) {
+    if (!fa(u)) { if (&vcon!=&vcom) vcon[u] = vcom[u]; continue; }
+    size_t n = x.degree(u);
+    us.push_back(u);
+    ucs.push_back(ucs.back() + (n+E-1)/E);
+    if ((nb += n) < COPRA_HUB_BATCH) continue;
+    ubs.push_back(us.size()); nb = 0;
+  }
+  if (ubs.back()!=us.size()) ubs.push_back(us.size());
+  // Thread, and range of labels scanned from each chunk.
+  vector<tuple<int, size_t, size_t>> vls(ucs.back());
+  #pragma omp parallel
+  {
+    int t = omp_get_thread_num();
+    auto& cs = *vcs[t];
+    auto& co = *vcout[t];
+    auto& hs = *vhs[t];
+    auto& ht = *vht[t];
+    for (size_t b=1; b<ubs.size(); ++b) {
+      size_t hb = ubs[b-1], he = ubs[b];
+      hs.clear();
+      // Scan each chunk of the hubs in this batch.
+      #pragma omp for schedule(dynamic, 1) reduction(+:ts)
+      for (size_t i=ucs[hb]; i<ucs[he]; ++i) {
+        decltype(timeNow()) t0;
+        if (TRACE) t0 = timeNow();
+        size_t h = upper_bound(ucs.begin()+hb, ucs.begin()+he+1, i) - ucs.begin() - 1;
+        K u = us[h];
+        auto [ib, ie] = x.edgeRange(u);
+        size_t jb = ib + (i-ucs[h])*E, je = min(jb+E, size_t(ie));
+        copraClearScan(cs, co);
+        copraReserveScan(co, min((je-jb)*L, S));
+        for (size_t j=jb; j<je; ++j)
+          copraScanCommunity<SELF>(cs, co, u, x.ekeys[j], UNWEIGHTED? V(1) : V(x.evalues[j]), vcom);
+        size_t lb = hs.size();
+        for (K c : cs)
+          hs.push_back({c, co[c]});
+        vls[i] = {t, lb, hs.size()};
+        if (TRACE) ts += durationMilliseconds(t0, timeNow());
+      }
+      // Merge the chunks of each hub in order, and move it.
+      #pragma omp for schedule(dynamic, 1) reduction(+:a, np, ne, ts, tt, tc)
+      for (size_t h=hb; h<he; ++h) {
+        decltype(timeNow()) t0, t1, t2;
+        if (TRACE) t0 = timeNow();
+        K u = us[h];
+        LabelsetOf<M> labs = vcom[u];
+        K d = labs[0].first;
+        size_t m = 0;
+        for (size_t i=ucs[h]; i<ucs[h+1]; ++i)
+          m += get<2>(vls[i]) - get<1>(vls[i]);
+        ht.clear();
+        ht.reserve(min(m, S));
+        copraClearScan(cs, co);
+        for (size_t i=ucs[h]; i<ucs[h+1]; ++i) {
+          auto [s, lb, le] = vls[i];
+          const auto& ls = *vhs[s];
+          for (size_t k=lb; k<le; ++k) {
+            auto& cw = ht[ls[k].first];
+            if (!cw) cs.push_back(ls[k].first);
+            cw += ls[k].second;
+          }
+        }
+        copraReserveScan(co, cs.size());
+        for (K c : cs)
+          co[c] = V(ht[c]);
+        if (TRACE) t1 = t2 = timeNow();
+        if (SORT) {
+          copraSortScan(cs, co, u, r);
+          if (TRACE) t2 = timeNow();
+          vcon[u] = copraChooseCommunity(x, u, vcom, cs, co, B*vtot[u]);
+        }
+        else vcon[u] = copraSelectCommunity(x, u, vcom, cs, co, B*vtot[u], r);
+        if (TRACE) {
+          ++np; ne += x.degree(u);
+          ts += durationMilliseconds(t1 - t0);
+          tt += durationMilliseconds(t2 - t1);
+          tc += durationMilliseconds(timeNow() - t2);
+        }
+        K c = vcon[u][0].first;
+        fc(u, labs, vcon[u]);
+        if (c!=d) { ++a; fp(u); }
+      }
+    }
+  }
+  if (TRACE) {
+    tr.processed += np; tr.edges += ne;
+    tr.scanTime  += ts; tr.sortTime += tt; tr.chooseTime += tc;
+  }
+  return a;
+}
+
+
+
+
+// COPRA-MOVE-ITERATION
+// --------------------
+
+/**
+ * Move each vertex to its best community, using multiple threads.
+ * @param vcs communities vertex u is linked to, for each thread (updated)
+ * @param vcout total edge weight from vertex u to community C, as an array or CopraScanTable, for each thread (updated)
+ * @param vhs labels scanned from each chunk of hub edges, by each thread (updated)
+ * @param vht merged labels of a hub, for each thread (updated)
+ * @param vcon community set each vertex belongs to, after this iteration (updated)
+ * @param vcom community set each vertex belongs to (same as vcon, if asynchronous)
+ * @param x original graph
+ * @param hubs vertices whose scans are split across threads (see copraMoveHubsOmp())
+ * @param D degree above which a vertex is a hub (0 = no hubs)
+ * @param vtot total edge weight of each vertex
+ * @param B belonging coefficient threshold
+ * @param r tie-breaking salt of this iteration (see copraTieSalt())
+ * @param fa is vertex affected? (u)
+ * @param fp called with each vertex whose best community changed (u)
+ * @param fc called with each processed vertex, and its community set before and after (u, labs, labn)
+ * @param tr iteration trace (updated, if TRACE)
+ * @returns number of changed vertices
+ */
+template <bool SORT=false, bool TRACE=false, bool UNWEIGHTED=false, bool SELF=false, class G, class K, class C, class M, class V, class FA, class FP, class FC>
+K copraMoveIterationOmp(vector<vector<K>*>& vcs, vector<C*>& vcout, vector<vector<pair<K, V>>*>& vhs, vector<CopraScanTable<K, double>*>& vht, M& vcon, const M& vcom, const G& x, const vector<K>& hubs, K D, const vector<V>& vtot, V B, uint64_t r, FA fa, FP fp, FC fc, CopraIterationTrace& tr) {
+  constexpr size_t L = tuple_size<LabelsetOf<M>>::value;
+  K a = K();
+  K S = x.span();
+  size_t np = 0, ne = 0;
+  double ts = 0, tt = 0, tc = 0;
+  // Scans of hubs are split by edge ranges, so only graphs with CSR rows have hubs.
+  if constexpr (CopraCsrRows<G>::value) {
+    if (!hubs.empty()) a = copraMoveHubsOmp<SORT, TRACE, UNWEIGHTED, SELF>(vcs, vcout, vhs, vht, vcon, vcom, x, hubs, vtot, B, r, fa, fp, fc, tr);
+  }
+  else D = K();
+  #pragma omp parallel for schedule(dynamic, 2048) reduction(+:a, np, ne, ts, tt, tc)
+  for (K u=0; u<S; ++u) {
+    int t = omp_get_thread_num();
+    if (!x.hasVertex(u)) continue;
+    if (D>K() && x.degree(u) > D) continue;
+    if (!fa(u)) { if (&vcon!=&vcom) vcon[u] = vcom[u]; continue; }
+    decltype(timeNow()) t0, t1, t2;
+    if (TRACE) t0 = timeNow();
+    LabelsetOf<M> labs = vcom[u];
+    K d = labs[0].first;
+    copraClearScan(*vcs[t], *vcout[t]);
+    copraReserveScan(*vcout[t], min(size_t(x.degree(u))*L, size_t(S)));
+    copraScanCommunities<SELF, UNWEIGHTED>(*vcs[t], *vcout[t], x, u, vcom);
+    if (TRACE) t1 = t2 = timeNow();
+    if (SORT) {
+      copraSortScan(*vcs[t], *vcout[t], u, r);
+      if (TRACE) t2 = timeNow();
+      vcon[u] = copraChooseCommunity(x, u, vcom, *vcs[t], *vcout[t], B*vtot[u]);
+    }
+    else vcon[u] = copraSelectCommunity(x, u, vcom, *vcs[t], *vcout[t], B*vtot[u], r);
+    if (TRACE) {
+      ++np; ne += x.degree(u);
+      ts += durationMilliseconds(t1 - t0);
+      tt += durationMilliseconds(t2 - t1);
+      tc += durationMilliseconds(timeNow() - t2);
+    }
+    K c = vcon[u][0].first;
+    fc(u, labs, vcon[u]);
+    if (c!=d) { ++a; fp(u); }
+  }
+  if (TRACE) {
+    tr.processed += np; tr.edges += ne;
+    tr.scanTime  += ts; tr.sortTime += tt; tr.chooseTime += tc;
+  }
+  return a;
+}
+
+
+
+template <bool SORT=false, bool UNWEIGHTED=false, bool SELF=false, class G, class K, class V, class M, class F>
+K copraMoveIterationWorklistOmp(vector<vector<K>*>& vcs, vector<vector<V>*>& vcout, vector<vector<K>*>& vqn, vector<F>& vnext, M& vcom, const G& x, const vector<K>& vq, const vector<V>& vtot, V B, uint64_t r) {
+  K a = K();
+  size_t Q = vq.size();
+  #pragma omp parallel for schedule(auto)
+  for (size_t i=0; i<Q; ++i)
+    vnext[vq[i]] = false;
+  #pragma omp parallel for schedule(dynamic, 2048) reduction(+:a)
+  for (size_t i=0; i<Q; ++i) {
+    int t = omp_get_thread_num();
+    K u = vq[i];
+    LabelsetOf<M> labs = vcom[u];
+    copraClearScan(*vcs[t], *vcout[t]);
+    copraScanCommunities<SELF, UNWEIGHTED>(*vcs[t], *vcout[t], x, u, vcom);
+    if (SORT) {
+      copraSortScan(*vcs[t], *vcout[t], u, r);
+      vcom[u] = copraChooseCommunity(x, u, vcom, *vcs[t], *vcout[t], B*vtot[u]);
+    }
+    else vcom[u] = copraSelectCommunity(x, u, vcom, *vcs[t], *vcout[t], B*vtot[u], r);
+    LabelsetOf<M> labn = vcom[u];
+    if (labn==labs) continue;
+    if (labn[0].first!=labs[0].first) ++a;
+    x.forEachEdgeKey(u, [&](auto v) {
+      F f;
+      #pragma omp atomic capture
+      { f = vnext[v]; vnext[v] = true; }
+      if (!f) vqn[t]->push_back(v);
+    });
+  }
+  return a;
+}
+
+
+
+
+// COPRA-GATHER-WORKLIST
+// ---------------------
+
+/**
+ * Gather per-thread worklists into a single worklist, and clear them.
+ * @param a gathered worklist (output)
+ * @param vqn worklist of each thread (updated)
+ */
+template <class K>
+inline void copraGatherWorklistOmpW(vector<K>& a, vector<vector<K>*>& vqn) {
+  size_t T = vqn.size();
+  vector<size_t> offs(T+1);
+  for (size_t t=0; t<T; ++t)
+    offs[t] = vqn[t]->size();
+  offs[T] = 0;
+  exclusiveScanW(offs, offs);
+  a.resize(offs[T]);
+  #pragma omp parallel for schedule(static, 1)
+  for (size_t t=0; t<T; ++t) {
+    copy(vqn[t]->begin(), vqn[t]->end(), a.begin()+offs[t]);
+    vqn[t]->clear();
+  }
+}
+
+
+
+
+// COPRA-OMP
+// ---------
+
+/**
+ * Find overlapping communities using COPRA, on multiple threads.
+ * @param w workspace with buffers to reuse (updated)
+ * @param x original graph
+ * @param q initial community (vector<K>), or community set (LABELSETS) of each vertex, for warm-start (or null, or &w.vcom to resume)
+ * @param o copra options
+ * @param fa is vertex affected? (u)
+ * @param fp called with each vertex whose best community changed (u)
+ * @returns copra result
+ */
+template <bool TRACE=false, class W, class G, class Q, class FA, class FP>
+auto copraOmpW(W& w, const G& x, const Q* q, const CopraOptions& o, FA fa, FP fp) {
+  using K = typename G::key_type;
+  using V = typename G::edge_value_type;
+  using M = typename W::labelsets_type;
+  constexpr size_t L = tuple_size<LabelsetOf<M>>::value;
+  int l = 0;
+  int T = omp_get_max_threads();
+  K S = x.span();
+  K N = x.order();
+  K D = copraHubDegree<K>(o.hubDegree);
+  V B = copraThreshold<V>(o, L);
+  w.resizeThreadScans(S, T, !o.hashScan);
+  if (D>K()) w.resizeHubScans(T);
+  w.resizeLabelsets(S, o.synchronous);
+  if (o.computeModularity) w.resizeCommunityWeights(S);
+  int  k  = min(o.stableIterations, 127);
+  bool fc = o.convergence==CopraConvergence::COUNT;
+  bool fd = o.convergence==CopraConvergence::BELONGING;
+  w.resizeConvergence(S, fc, k>0);
+  auto& vcs  = w.tvcs;
+  auto& vcout = w.tvcout;
+  const auto& vtot = w.sharedWeights? *w.sharedWeights : w.vtot;
+  auto& vcom = w.vcom;
+  auto& vcon = w.vcon;
+  CopraTrace tr;
+  double modularity = 0;
+  bool fw = !w.freshWeights && !w.sharedWeights;
+  bool fq = q && !w.ownsLabelsets(q);
+  double delta = 0;
+  pair<K, K> cnow, cold;
+  // Skip vertices stable for k iterations, and track changes needed for convergence.
+  // Stable counts of neighbors are reset by other threads, so they are accessed atomically.
+  auto fs = [&](auto u) {
+    char s;
+    #pragma omp atomic read
+    s = w.vstable[u];
+    return s;
+  };
+  auto fb = [&](auto u) { return (k<=0 || fs(u)<k) && fa(u); };
+  auto fl = [&](auto u, const auto& labs, const auto& b) {
+    if (!fc && !fd && k<=0) return;
+    LabelsetOf<M> labn = b;
+    if (labs==labn) {
+      if (k<=0 || fs(u)>=k) return;
+      #pragma omp atomic update
+      ++w.vstable[u];
+      return;
+    }
+    if (fd) {
+      double e = copraBelongingDelta(labs, labn);
+      #pragma omp atomic
+      delta += e;
+    }
+    if (fc) copraUpdateCountOmpU(w.vccount, labs, labn);
+    if (k>0) {
+      #pragma omp atomic write
+      w.vstable[u] = char();
+      x.forEachEdgeKey(u, [&](auto v) {
+        #pragma omp atomic write
+        w.vstable[v] = char();
+      });
+    }
+  };
+  w.freshWeights = false;
+  float ts = 0;
+  float t = measureDuration([&]() {
+    if (TRACE) tr = {};
+    auto t0 = timeNow();
+    if (fw) { if (o.unweighted) copraVertexWeightsOmp<true>(w.vtot, x); else copraVertexWeightsOmp(w.vtot, x); }
+    copraHubVerticesW(w.vhubs, x, D);
+    auto t1 = timeNow();
+    if (fq)     copraInitializeFromOmp(vcom, x, *q);
+    else if (!q) copraInitializeOmp(vcom, x);
+    if (fc) { copraCountVerticesOmpW(w.vccount, x, vcom); cold = copraCountSummaryOmp(w.vccount); }
+    if (k>0) fillValueOmpU(w.vstable, char());
+    auto t4 = timeNow();
+    ts += durationMilliseconds(t0, t4);
+    if (TRACE) {
+      tr.vertexWeightsTime = durationMilliseconds(t0, t1);
+      tr.initializeTime    = durationMilliseconds(t1, t4);
+    }
+    for (l=0; l<o.maxIterations;) {
+      CopraIterationTrace ti = {};
+      auto t2 = timeNow();
+      uint64_t r = copraTieSalt(o.seed, l);
+      delta = 0;
+      auto fi = [&](auto& vcon, auto& vcs, auto& vcout) {
+        if (o.fullSort) return copraMoveIterationOmp<true, TRACE>(vcs, vcout, w.tvhs, w.tvht, vcon, vcom, x, w.vhubs, D, vtot, B, r, fb, fp, fl, ti);
+        return copraDispatchTraits(o, [&](auto UW, auto SL) {
+          constexpr bool UNWEIGHTED = decltype(UW)::value, SELF = decltype(SL)::value;
+          return copraMoveIterationOmp<false, TRACE, UNWEIGHTED, SELF>(vcs, vcout, w.tvhs, w.tvht, vcon, vcom, x, w.vhubs, D, vtot, B, r, fb, fp, fl, ti);
+        });
+      };
+      auto fj = [&](auto& vcs, auto& vcout) { return o.synchronous? fi(vcon, vcs, vcout) : fi(vcom, vcs, vcout); };
+      K n = o.hashScan? fj(w.tvtcs, w.tvtab) : fj(vcs, vcout); ++l;
+      if (o.synchronous) swap(vcom, vcon);
+      if (TRACE) {
+        ti.changed = n;
+        ti.time    = durationMilliseconds(t2, timeNow());
+        tr.iterations.push_back(ti);
+      }
+      PRINTFD("copraOmp(): l=%d, n=%d, N=%d, n/N=%f\n", l, n, N, float(n)/N);
+      if (fc) cnow = copraCountSummaryOmp(w.vccount);
+      if (copraConverged(o, n, N, delta, cnow, cold)) break;
+      cold = cnow;
+    }
+    if (o.computeModularity) {
+      double cin = o.hashScan? copraWithinWeightOmpW(w.tvtcs, w.tvtab, x, vcom) : copraWithinWeightOmpW(vcs, vcout, x, vcom);
+      modularity = copraModularityOmpW(w.vctot, x, vcom, vtot, cin);
+    }
+  }, o.repeat);
+  auto t3 = timeNow();
+  vector<size_t> aoff;
+  vector<pair<K, V>> alab;
+  if (o.saveLabelsets) copraCompactLabelsetsOmpW(aoff, alab, vcom);
+  CopraResult<K, V> a(copraBestCommunitiesOmp(vcom), move(aoff), move(alab), l, t);
+  a.setupTime  = ts / o.repeat;
+  a.modularity = modularity;
+  if (TRACE) {
+    tr.extractTime = durationMilliseconds(t3, timeNow());
+    a.trace = move(tr);
+  }
+  return a;
+}
+template <bool TRACE=false, class W, class G, class Q, class FA>
+inline auto copraOmpW(W& w, const G& x, const Q* q, const CopraOptions& o, FA fa) {
+  auto fp = [](auto u) {};
+  return copraOmpW<TRACE>(w, x, q, o, fa, fp);
+}
+template <bool TRACE=false, class W, class G, class Q>
+inline auto copraOmpW(W& w, const G& x, const Q* q, const CopraOptions& o) {
+  auto fa = [](auto u) { return true; };
+  return copraOmpW<TRACE>(w, x, q, o, fa);
+}
+
+
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, bool TRACE=false, class G, class Q, class FA, class FP>
+inline auto copraOmp(const G& x, const Q* q, const CopraOptions& o, FA fa, FP fp) {
+  using K = typename G::key_type;
+  using V = typename G::edge_value_type;
+  CopraWorkspace<K, V, LABELSETS<K, V, LABELS>> w;
+  return copraOmpW<TRACE>(w, x, q, o, fa, fp);
+}
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, bool TRACE=false, class G, class Q, class FA>
+inline auto copraOmp(const G& x, const Q* q, const CopraOptions& o, FA fa) {
+  auto fp = [](auto u) {};
+  return copraOmp<LABELS, LABELSETS, TRACE>(x, q, o, fa, fp);
+}
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, bool TRACE=false, class G, class Q>
+inline auto copraOmp(const G& x, const Q* q, const CopraOptions& o) {
+  auto fa = [](auto u) { return true; };
+  return copraOmp<LABELS, LABELSETS, TRACE>(x, q, o, fa);
+}
+
+
+
+
+// COPRA-OMP-STATIC
+// ----------------
+
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, bool TRACE=false, class G, class Q>
+inline auto copraOmpStatic(const G& x, const Q* q=nullptr, const CopraOptions& o={}) {
+  return copraOmp<LABELS, LABELSETS, TRACE>(x, q, o);
+}
+
+template <template <class, class, size_t> class LABELSETS=LabelsetVector, bool TRACE=false, class G, class Q>
+inline auto copraOmpStaticLabels(const G& x, const Q* q=nullptr, const CopraOptions& o={}) {
+  size_t maxLabels = o.maxLabels>0? o.maxLabels : COPRA_MAX_MEMBERSHIP;
+  return copraDispatchLabels(maxLabels, [&](auto L) { return copraOmp<decltype(L)::value, LABELSETS, TRACE>(x, q, o); });
+}
+
+
+
+
+// COPRA-OMP-WORKLIST
+// ------------------
+
+/**
+ * Find overlapping communities using COPRA, on multiple threads, with a worklist of active vertices.
+ * @param w workspace with buffers to reuse (updated)
+ * @param x original graph
+ * @param q initial community (vector<K>), or community set of each vertex, for warm-start (or null, or &w.vcom to resume)
+ * @param o copra options (synchronous, hashScan, computeModularity, and convergence are rejected; hubDegree, and stableIterations are ignored)
+ * @param fa is vertex initially active? (u)
+ * @returns copra result
+ */
+template <class W, class G, class Q, class FA>
+auto copraOmpWorklistW(W& w, const G& x, const Q* q, const CopraOptions& o, FA fa) {
+  using K = typename G::key_type;
+  using V = typename G::edge_value_type;
+  using M = typename W::labelsets_type;
+  constexpr size_t L = tuple_size<LabelsetOf<M>>::value;
+  copraCheckWorklistOptions(o, "copraOmpWorklistW");
+  int l = 0;
+  int T = omp_get_max_threads();
+  K S = x.span();
+  K N = x.order();
+  V B = copraThreshold<V>(o, L);
+  w.resizeThreadScans(S, T);
+  w.resizeLabelsets(S);
+  w.resizeWorklist(S, T);
+  auto& vcs   = w.tvcs;
+  auto& vcout = w.tvcout;
+  auto& vq    = w.vq;
+  auto& vqn   = w.tvqn;
+  auto& vnext = w.vnext;
+  auto& vcom  = w.vcom;
+  const auto& vtot = w.sharedWeights? *w.sharedWeights : w.vtot;
+  bool fw = !w.freshWeights && !w.sharedWeights;
+  bool fq = q && !w.ownsLabelsets(q);
+  w.freshWeights = false;
+  float ts = 0;
+  float t = measureDuration([&]() {
+    auto t0 = timeNow();
+    vq.clear();
+    for (int t=0; t<T; ++t)
+      vqn[t]->clear();
+    fillValueOmpU(vnext, char());
+    if (fw) { if (o.unweighted) copraVertexWeightsOmp<true>(w.vtot, x); else copraVertexWeightsOmp(w.vtot, x); }
+    if (fq)     copraInitializeFromOmp(vcom, x, *q);
+    else if (!q) copraInitializeOmp(vcom, x);
+    x.forEachVertexKey([&](auto u) { if (fa(u)) vq.push_back(u); });
+    ts += durationMilliseconds(t0, timeNow());
+    for (l=0; l<o.maxIterations && !vq.empty();) {
+      uint64_t r = copraTieSalt(o.seed, l);
+      K n = o.fullSort? copraMoveIterationWorklistOmp<true>(vcs, vcout, vqn, vnext, vcom, x, vq, vtot, B, r) : copraDispatchTraits(o, [&](auto UW, auto SL) {
+        constexpr bool UNWEIGHTED = decltype(UW)::value, SELF = decltype(SL)::value;
+        return copraMoveIterationWorklistOmp<false, UNWEIGHTED, SELF>(vcs, vcout, vqn, vnext, vcom, x, vq, vtot, B, r);
+      }); ++l;
+      copraGatherWorklistOmpW(vq, vqn);
+      sort(vq.begin(), vq.end());
+      PRINTFD("copraOmpWorklist(): l=%d, n=%d, N=%d, n/N=%f, |Q|=%zu\n", l, n, N, float(n)/N, vq.size());
+      if (float(n)/N <= o.tolerance) break;
+    }
+  }, o.repeat);
+  vector<size_t> aoff;
+  vector<pair<K, V>> alab;
+  if (o.saveLabelsets) copraCompactLabelsetsOmpW(aoff, alab, vcom);
+  CopraResult<K, V> a(copraBestCommunitiesOmp(vcom), move(aoff), move(alab), l, t);
+  a.setupTime = ts / o.repeat;
+  return a;
+}
+
+
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, class G, class Q, class FA>
+inline auto copraOmpWorklist(const G& x, const Q* q, const CopraOptions& o, FA fa) {
+  using K = typename G::key_type;
+  using V = typename G::edge_value_type;
+  CopraWorkspace<K, V, LABELSETS<K, V, LABELS>> w;
+  return copraOmpWorklistW(w, x, q, o, fa);
+}
+
+
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, class G, class Q>
+inline auto copraOmpWorklistStatic(const G& x, const Q* q=nullptr, const CopraOptions& o={}) {
+  auto fa = [](auto u) { return true; };
+  return copraOmpWorklist<LABELS, LABELSETS>(x, q, o, fa);
+}
+
+
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, class G, class K, class V, class Q>
+inline auto copraOmpWorklistDynamicFrontier(const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const Q* q, const CopraOptions& o={}) {
+  const size_t L = LABELS;
+  K S = x.span();
+  LABELSETS<K, V, L> vcom(S);
+  copraInitializeFromOmp(vcom, x, *q);
+  auto vaff = copraAffectedVerticesFrontier<char>(x, deletions, insertions, vcom);
+  auto fa = [&](auto u) { return vaff[u]==true; };
+  return copraOmpWorklist<LABELS, LABELSETS>(x, &vcom, o, fa);
+}
+
+
+
+
+// COPRA-OMP-DYNAMIC-DELTA-SCREENING
+// ---------------------------------
+
+/**
+ * Update overlapping communities upon a batch update, using delta-screening.
+ * @param w workspace with buffers to reuse (updated)
+ * @param x updated graph
+ * @param deletions edge deletions in this batch update (undirected, sorted by source vertex id)
+ * @param insertions edge insertions in this batch update (undirected, sorted by source vertex id)
+ * @param q previous community (vector<K>), or community set (LABELSETS) of each vertex (or &w.vcom, to resume)
+ * @param o copra options
+ * @returns copra result
+ */
+template <class W, class G, class K, class V, class Q>
+inline auto copraOmpDynamicDeltaScreeningW(W& w, const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const Q* q, const CopraOptions& o={}) {
+  using M = typename W::labelsets_type;
+  constexpr size_t L = tuple_size<LabelsetOf<M>>::value;
+  K S = x.span();
+  V B = copraThreshold<V>(o, L);
+  w.resizeScans(S);
+  w.resizeLabelsets(S);
+  w.resizeFlags(S, true);
+  if (w.ownsLabelsets(q)) { if (!w.freshWeights) copraUpdateVertexWeightsOmpW(w.vtot, x, deletions, insertions); }
+  else {
+    copraVertexWeightsOmp(w.vtot, x);
+    copraInitializeFromOmp(w.vcom, x, *q);
+  }
+  w.freshWeights = true;
+  copraAffectedVerticesDeltaScreeningOmpW(w.vaff, w.vneighbors, w.vcommunities, w.vcs, w.vcout, x, deletions, insertions, w.vcom, w.vtot, B);
+  auto fa = [&](auto u) { return w.vaff[u]==true; };
+  return copraOmpW(w, x, q, o, fa);
+}
+
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, class G, class K, class V, class Q>
+inline auto copraOmpDynamicDeltaScreening(const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const Q* q, const CopraOptions& o={}) {
+  CopraWorkspace<K, V, LABELSETS<K, V, LABELS>> w;
+  return copraOmpDynamicDeltaScreeningW(w, x, deletions, insertions, q, o);
+}
+
+
+
+
+// COPRA-OMP-DYNAMIC-FRONTIER
+// --------------------------
+
+/**
+ * Update overlapping communities upon a batch update, using dynamic frontier.
+ * @param w workspace with buffers to reuse (updated)
+ * @param x updated graph
+ * @param deletions edge deletions in this batch update (undirected, sorted by source vertex id)
+ * @param insertions edge insertions in this batch update (undirected, sorted by source vertex id)
+ * @param q previous community (vector<K>), or community set (LABELSETS) of each vertex (or &w.vcom, to resume)
+ * @param o copra options
+ * @returns copra result
+ */
+template <class W, class G, class K, class V, class Q>
+inline auto copraOmpDynamicFrontierW(W& w, const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const Q* q, const CopraOptions& o={}) {
+  K S = x.span();
+  w.resizeLabelsets(S);
+  w.resizeFlags(S);
+  if (w.ownsLabelsets(q)) {
+    if (!w.freshWeights) copraUpdateVertexWeightsOmpW(w.vtot, x, deletions, insertions);
+    w.freshWeights = true;
+  }
+  else copraInitializeFromOmp(w.vcom, x, *q);
+  copraAffectedVerticesFrontierW(w.vaff, x, deletions, insertions, w.vcom);
+  auto fa = [&](auto u) { return w.vaff[u]==true; };
+  auto fp = [&](auto u) { x.forEachEdgeKey(u, [&](auto v) { w.vaff[v] = true; }); };
+  return copraOmpW(w, x, q, o, fa, fp);
+}
+
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, class G, class K, class V, class Q>
+inline auto copraOmpDynamicFrontier(const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const Q* q, const CopraOptions& o={}) {
+  CopraWorkspace<K, V, LABELSETS<K, V, LABELS>> w;
+  return copraOmpDynamicFrontierW(w, x, deletions, insertions, q, o);
+}
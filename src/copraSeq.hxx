@@ -8,10 +8,14 @@
 #include "csr.hxx"
 #include "copra.hxx"
 
+using std::pair;
 using std::tuple;
 using std::vector;
 using std::make_pair;
 using std::swap;
+using std::sort;
+using std::min;
+using std::move;
 
 
 
@@ -22,26 +26,97 @@ using std::swap;
 /**
  * Move each vertex to its best community.
  * @param vcs communities vertex u is linked to (updated)
- * @param vcout total edge weight from vertex u to community C (updated)
- * @param vcom community set each vertex belongs to (updated)
+ * @param vcout total edge weight from vertex u to community C, as an array or CopraScanTable (updated)
+ * @param vcon community set each vertex belongs to, after this iteration (updated)
+ * @param vcom community set each vertex belongs to (same as vcon, if asynchronous)
  * @param x original graph
  * @param vtot total edge weight of each vertex
  * @param B belonging coefficient threshold
+ * @param r tie-breaking salt of this iteration (see copraTieSalt())
+ * @param fa is vertex affected? (u)
+ * @param fp called with each vertex whose best community changed (u)
+ * @param fc called with each processed vertex, and its community set before and after (u, labs, labn)
+ * @param tr iteration trace (updated, if TRACE)
  * @returns number of changed vertices
  */
-template <class G, class K, class V, size_t L, class FA, class FP>
-K copraMoveIteration(vector<K>& vcs, vector<V>& vcout, vector<Labelset<K, V, L>>& vcom, const G& x, const vector<V>& vtot, V B, FA fa, FP fp) {
+template <bool SORT=false, bool TRACE=false, bool UNWEIGHTED=false, bool SELF=false, class G, class K, class C, class M, class V, class FA, class FP, class FC>
+K copraMoveIteration(vector<K>& vcs, C& vcout, M& vcon, const M& vcom, const G& x, const vector<V>& vtot, V B, uint64_t r, FA fa, FP fp, FC fc, CopraIterationTrace& tr) {
+  constexpr size_t L = tuple_size<LabelsetOf<M>>::value;
   K a = K();
+  K S = x.span();
+  size_t np = 0, ne = 0;
+  double ts = 0, tt = 0, tc = 0;
   x.forEachVertexKey([&](auto u) {
-    if (!fa(u)) return;
-    K d = vcom[u][0].first;
+    if (!fa(u)) { if (&vcon!=&vcom) vcon[u] = vcom[u]; return; }
+    decltype(timeNow()) t0, t1, t2;
+    if (TRACE) t0 = timeNow();
+    LabelsetOf<M> labs = vcom[u];
+    K d = labs[0].first;
     copraClearScan(vcs, vcout);
-    copraScanCommunities(vcs, vcout, x, u, vcom);
-    copraSortScan(vcs, vcout);
-    vcom[u] = copraChooseCommunity(x, u, vcom, vcs, vcout, B*vtot[u]);
-    K c = vcom[u][0].first;
+    copraReserveScan(vcout, min(size_t(x.degree(u))*L, size_t(S)));
+    copraScanCommunities<SELF, UNWEIGHTED>(vcs, vcout, x, u, vcom);
+    if (TRACE) t1 = t2 = timeNow();
+    if (SORT) {
+      copraSortScan(vcs, vcout, u, r);
+      if (TRACE) t2 = timeNow();
+      vcon[u] = copraChooseCommunity(x, u, vcom, vcs, vcout, B*vtot[u]);
+    }
+    else vcon[u] = copraSelectCommunity(x, u, vcom, vcs, vcout, B*vtot[u], r);
+    if (TRACE) {
+      ++np; ne += x.degree(u);
+      ts += durationMilliseconds(t1 - t0);
+      tt += durationMilliseconds(t2 - t1);
+      tc += durationMilliseconds(timeNow() - t2);
+    }
+    K c = vcon[u][0].first;
+    fc(u, labs, vcon[u]);
     if (c!=d) { ++a; fp(u); }
   });
+  if (TRACE) {
+    tr.processed = np; tr.edges = ne;
+    tr.scanTime  = ts; tr.sortTime = tt; tr.chooseTime = tc;
+  }
+  return a;
+}
+
+
+/**
+ * Move each vertex in worklist to its best community, and add neighbors of changed vertices to next worklist.
+ * @param vcs communities vertex u is linked to (updated)
+ * @param vcout total edge weight from vertex u to community C (updated)
+ * @param vqn next worklist (updated)
+ * @param vnext is vertex in next worklist? (updated)
+ * @param vcom community set each vertex belongs to (updated)
+ * @param x original graph
+ * @param vq current worklist
+ * @param vtot total edge weight of each vertex
+ * @param B belonging coefficient threshold
+ * @param r tie-breaking salt of this iteration (see copraTieSalt())
+ * @returns number of vertices whose best community changed
+ */
+template <bool SORT=false, bool UNWEIGHTED=false, bool SELF=false, class G, class K, class V, class M, class F>
+K copraMoveIterationWorklist(vector<K>& vcs, vector<V>& vcout, vector<K>& vqn, vector<F>& vnext, M& vcom, const G& x, const vector<K>& vq, const vector<V>& vtot, V B, uint64_t r) {
+  K a = K();
+  for (K u : vq)
+    vnext[u] = false;
+  for (K u : vq) {
+    LabelsetOf<M> labs = vcom[u];
+    copraClearScan(vcs, vcout);
+    copraScanCommunities<SELF, UNWEIGHTED>(vcs, vcout, x, u, vcom);
+    if (SORT) {
+      copraSortScan(vcs, vcout, u, r);
+      vcom[u] = copraChooseCommunity(x, u, vcom, vcs, vcout, B*vtot[u]);
+    }
+    else vcom[u] = copraSelectCommunity(x, u, vcom, vcs, vcout, B*vtot[u], r);
+    LabelsetOf<M> labn = vcom[u];
+    if (labn==labs) continue;
+    if (labn[0].first!=labs[0].first) ++a;
+    x.forEachEdgeKey(u, [&](auto v) {
+      if (vnext[v]) return;
+      vnext[v] = true;
+      vqn.push_back(v);
+    });
+  }
   return a;
 }
 
@@ -51,37 +126,148 @@ K copraMoveIteration(vector<K>& vcs, vector<V>& vcout, vector<Labelset<K, V, L>>
 // COPRA-SEQ
 // ---------
 
-template <size_t LABELS=COPRA_MAX_MEMBERSHIP, class G, class K, class FA, class FP>
-CopraResult<K> copraSeq(const G& x, const vector<K>* q, const CopraOptions& o, FA fa, FP fp) {
+/**
+ * Find overlapping communities using COPRA, on a single thread.
+ * @param w workspace with buffers to reuse (updated)
+ * @param x original graph
+ * @param q initial community (vector<K>), or community set of each vertex, for warm-start (or null, or &w.vcom to resume)
+ * @param o copra options
+ * @param fa is vertex affected? (u)
+ * @param fp called with each vertex whose best community changed (u)
+ * @returns copra result
+ */
+template <bool TRACE=false, class W, class G, class Q, class FA, class FP>
+auto copraSeqW(W& w, const G& x, const Q* q, const CopraOptions& o, FA fa, FP fp) {
+  using K = typename G::key_type;
   using V = typename G::edge_value_type;
-  const size_t L = LABELS;
+  using M = typename W::labelsets_type;
+  constexpr size_t L = tuple_size<LabelsetOf<M>>::value;
   int l = 0;
   K S = x.span();
   K N = x.order();
-  V B = V(1)/LABELS;
-  vector<K> vcs;
-  vector<V> vcout(S), vtot(S);
-  vector<Labelset<K, V, L>> vcom(S);
+  V B = copraThreshold<V>(o, L);
+  w.resizeScans(S, !o.hashScan);
+  w.resizeLabelsets(S, o.synchronous);
+  if (o.computeModularity) w.resizeCommunityWeights(S);
+  int  k  = min(o.stableIterations, 127);
+  bool fc = o.convergence==CopraConvergence::COUNT;
+  bool fd = o.convergence==CopraConvergence::BELONGING;
+  w.resizeConvergence(S, fc, k>0);
+  auto& vcs  = w.vcs;
+  auto& vcout = w.vcout;
+  const auto& vtot = w.sharedWeights? *w.sharedWeights : w.vtot;
+  auto& vcom = w.vcom;
+  auto& vcon = w.vcon;
+  CopraTrace tr;
+  double modularity = 0;
+  bool fw = !w.freshWeights && !w.sharedWeights;
+  bool fq = q && !w.ownsLabelsets(q);
+  double delta = 0;
+  pair<K, K> cnow, cold;
+  // Skip vertices stable for k iterations, and track changes needed for convergence.
+  auto fb = [&](auto u) { return (k<=0 || w.vstable[u]<k) && fa(u); };
+  auto fl = [&](auto u, const auto& labs, const auto& b) {
+    if (!fc && !fd && k<=0) return;
+    LabelsetOf<M> labn = b;
+    if (labs==labn) { if (k>0 && w.vstable[u]<k) ++w.vstable[u]; return; }
+    if (fd) {
+      double e = copraBelongingDelta(labs, labn);
+      delta += e;
+    }
+    if (fc) copraUpdateCountU(w.vccount, labs, labn);
+    if (k>0) {
+      w.vstable[u] = 0;
+      x.forEachEdgeKey(u, [&](auto v) { w.vstable[v] = 0; });
+    }
+  };
+  w.freshWeights = false;
+  float ts = 0;
   float t = measureDuration([&]() {
-    copraVertexWeights(vtot, x);
-    copraInitialize(vcom, x);
+    if (TRACE) tr = {};
+    auto t0 = timeNow();
+    if (fw) { if (o.unweighted) copraVertexWeights<true>(w.vtot, x); else copraVertexWeights(w.vtot, x); }
+    auto t1 = timeNow();
+    if (fq)     copraInitializeFrom(vcom, x, *q);
+    else if (!q) copraInitialize(vcom, x);
+    if (fc) { copraCountVerticesW(w.vccount, x, vcom); cold = copraCountSummary(w.vccount); }
+    if (k>0) fillValueU(w.vstable, char());
+    auto t4 = timeNow();
+    ts += durationMilliseconds(t0, t4);
+    if (TRACE) {
+      tr.vertexWeightsTime = durationMilliseconds(t0, t1);
+      tr.initializeTime    = durationMilliseconds(t1, t4);
+    }
     for (l=0; l<o.maxIterations;) {
-      K n = copraMoveIteration(vcs, vcout, vcom, x, vtot, B, fa, fp); ++l;
+      CopraIterationTrace ti = {};
+      auto t2 = timeNow();
+      uint64_t r = copraTieSalt(o.seed, l);
+      delta = 0;
+      auto fi = [&](auto& vcon, auto& vcs, auto& vcout) {
+        if (o.fullSort) return copraMoveIteration<true, TRACE>(vcs, vcout, vcon, vcom, x, vtot, B, r, fb, fp, fl, ti);
+        return copraDispatchTraits(o, [&](auto UW, auto SL) {
+          constexpr bool UNWEIGHTED = decltype(UW)::value, SELF = decltype(SL)::value;
+          return copraMoveIteration<false, TRACE, UNWEIGHTED, SELF>(vcs, vcout, vcon, vcom, x, vtot, B, r, fb, fp, fl, ti);
+        });
+      };
+      auto fj = [&](auto& vcs, auto& vcout) { return o.synchronous? fi(vcon, vcs, vcout) : fi(vcom, vcs, vcout); };
+      K n = o.hashScan? fj(w.vtcs, w.vtab) : fj(vcs, vcout); ++l;
+      if (o.synchronous) swap(vcom, vcon);
+      if (TRACE) {
+        ti.changed = n;
+        ti.time    = durationMilliseconds(t2, timeNow());
+        tr.iterations.push_back(ti);
+      }
       PRINTFD("copraSeq(): l=%d, n=%d, N=%d, n/N=%f\n", l, n, N, float(n)/N);
-      if (float(n)/N <= o.tolerance) break;
+      if (fc) cnow = copraCountSummary(w.vccount);
+      if (copraConverged(o, n, N, delta, cnow, cold)) break;
+      cold = cnow;
+    }
+    if (o.computeModularity) {
+      double cin = o.hashScan? copraWithinWeightW(w.vtcs, w.vtab, x, vcom) : copraWithinWeightW(vcs, vcout, x, vcom);
+      modularity = copraModularityW(w.vctot, x, vcom, vtot, cin);
     }
   }, o.repeat);
-  return {copraBestCommunities(vcom), l, t};
+  auto t3 = timeNow();
+  vector<size_t> aoff;
+  vector<pair<K, V>> alab;
+  if (o.saveLabelsets) copraCompactLabelsetsW(aoff, alab, vcom);
+  CopraResult<K, V> a(copraBestCommunities(vcom), move(aoff), move(alab), l, t);
+  a.setupTime  = ts / o.repeat;
+  a.modularity = modularity;
+  if (TRACE) {
+    tr.extractTime = durationMilliseconds(t3, timeNow());
+    a.trace = move(tr);
+  }
+  return a;
 }
-template <size_t LABELS=COPRA_MAX_MEMBERSHIP, class G, class K, class FA>
-inline CopraResult<K> copraSeq(const G& x, const vector<K>* q, const CopraOptions& o, FA fa) {
+template <bool TRACE=false, class W, class G, class Q, class FA>
+inline auto copraSeqW(W& w, const G& x, const Q* q, const CopraOptions& o, FA fa) {
   auto fp = [](auto u) {};
-  return copraSeq<LABELS>(x, q, o, fa, fp);
+  return copraSeqW<TRACE>(w, x, q, o, fa, fp);
 }
-template <size_t LABELS=COPRA_MAX_MEMBERSHIP, class G, class K>
-inline CopraResult<K> copraSeq(const G& x, const vector<K>* q, const CopraOptions& o) {
+template <bool TRACE=false, class W, class G, class Q>
+inline auto copraSeqW(W& w, const G& x, const Q* q, const CopraOptions& o) {
   auto fa = [](auto u) { return true; };
-  return copraSeq<LABELS>(x, q, o, fa);
+  return copraSeqW<TRACE>(w, x, q, o, fa);
+}
+
+
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, bool TRACE=false, class G, class Q, class FA, class FP>
+inline auto copraSeq(const G& x, const Q* q, const CopraOptions& o, FA fa, FP fp) {
+  using K = typename G::key_type;
+  using V = typename G::edge_value_type;
+  CopraWorkspace<K, V, LABELSETS<K, V, LABELS>> w;
+  return copraSeqW<TRACE>(w, x, q, o, fa, fp);
+}
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, bool TRACE=false, class G, class Q, class FA>
+inline auto copraSeq(const G& x, const Q* q, const CopraOptions& o, FA fa) {
+  auto fp = [](auto u) {};
+  return copraSeq<LABELS, LABELSETS, TRACE>(x, q, o, fa, fp);
+}
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, bool TRACE=false, class G, class Q>
+inline auto copraSeq(const G& x, const Q* q, const CopraOptions& o) {
+  auto fa = [](auto u) { return true; };
+  return copraSeq<LABELS, LABELSETS, TRACE>(x, q, o, fa);
 }
 
 
@@ -90,9 +276,132 @@ inline CopraResult<K> copraSeq(const G& x, const vector<K>* q, const CopraOption
 // COPRA-SEQ-STATIC
 // ----------------
 
-template <size_t LABELS=COPRA_MAX_MEMBERSHIP, class G, class K>
-inline CopraResult<K> copraSeqStatic(const G& x, const vector<K>* q=nullptr, const CopraOptions& o={}) {
-  return copraSeq<LABELS>(x, q, o);
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, bool TRACE=false, class G, class Q>
+inline auto copraSeqStatic(const G& x, const Q* q=nullptr, const CopraOptions& o={}) {
+  return copraSeq<LABELS, LABELSETS, TRACE>(x, q, o);
+}
+
+
+/**
+ * Find overlapping communities using COPRA, with labels per vertex chosen at runtime.
+ * @param x original graph
+ * @param q initial community (vector<K>), or community set of each vertex, for warm-start (or null)
+ * @param o copra options (maxLabels = labels per vertex, or 0 for COPRA_MAX_MEMBERSHIP)
+ * @returns copra result
+ */
+template <template <class, class, size_t> class LABELSETS=LabelsetVector, bool TRACE=false, class G, class Q>
+inline auto copraSeqStaticLabels(const G& x, const Q* q=nullptr, const CopraOptions& o={}) {
+  size_t maxLabels = o.maxLabels>0? o.maxLabels : COPRA_MAX_MEMBERSHIP;
+  return copraDispatchLabels(maxLabels, [&](auto L) { return copraSeq<decltype(L)::value, LABELSETS, TRACE>(x, q, o); });
+}
+
+
+
+
+// COPRA-SEQ-WORKLIST
+// ------------------
+// Process only vertices whose neighbors changed labels (asynchronous).
+// Worklist is kept sorted, so vertices are processed in the same order as a full sweep.
+
+/**
+ * Find overlapping communities using COPRA, on a single thread, with a worklist of active vertices.
+ * @param w workspace with buffers to reuse (updated)
+ * @param x original graph
+ * @param q initial community (vector<K>), or community set of each vertex, for warm-start (or null, or &w.vcom to resume)
+ * @param o copra options (synchronous, hashScan, computeModularity, and convergence are rejected; hubDegree, and stableIterations are ignored)
+ * @param fa is vertex initially active? (u)
+ * @returns copra result
+ */
+template <class W, class G, class Q, class FA>
+auto copraSeqWorklistW(W& w, const G& x, const Q* q, const CopraOptions& o, FA fa) {
+  using K = typename G::key_type;
+  using V = typename G::edge_value_type;
+  using M = typename W::labelsets_type;
+  constexpr size_t L = tuple_size<LabelsetOf<M>>::value;
+  copraCheckWorklistOptions(o, "copraSeqWorklistW");
+  int l = 0;
+  K S = x.span();
+  K N = x.order();
+  V B = copraThreshold<V>(o, L);
+  w.resizeScans(S);
+  w.resizeLabelsets(S);
+  w.resizeWorklist(S);
+  auto& vcs   = w.vcs;
+  auto& vcout = w.vcout;
+  auto& vq    = w.vq;
+  auto& vqn   = w.vqn;
+  auto& vnext = w.vnext;
+  auto& vcom  = w.vcom;
+  const auto& vtot = w.sharedWeights? *w.sharedWeights : w.vtot;
+  bool fw = !w.freshWeights && !w.sharedWeights;
+  bool fq = q && !w.ownsLabelsets(q);
+  w.freshWeights = false;
+  float ts = 0;
+  float t = measureDuration([&]() {
+    auto t0 = timeNow();
+    vq.clear();
+    vqn.clear();
+    fillValueU(vnext, char());
+    if (fw) { if (o.unweighted) copraVertexWeights<true>(w.vtot, x); else copraVertexWeights(w.vtot, x); }
+    if (fq)     copraInitializeFrom(vcom, x, *q);
+    else if (!q) copraInitialize(vcom, x);
+    x.forEachVertexKey([&](auto u) { if (fa(u)) vq.push_back(u); });
+    ts += durationMilliseconds(t0, timeNow());
+    for (l=0; l<o.maxIterations && !vq.empty();) {
+      uint64_t r = copraTieSalt(o.seed, l);
+      K n = o.fullSort? copraMoveIterationWorklist<true>(vcs, vcout, vqn, vnext, vcom, x, vq, vtot, B, r) : copraDispatchTraits(o, [&](auto UW, auto SL) {
+        constexpr bool UNWEIGHTED = decltype(UW)::value, SELF = decltype(SL)::value;
+        return copraMoveIterationWorklist<false, UNWEIGHTED, SELF>(vcs, vcout, vqn, vnext, vcom, x, vq, vtot, B, r);
+      }); ++l;
+      PRINTFD("copraSeqWorklist(): l=%d, n=%d, N=%d, n/N=%f, |Q|=%zu\n", l, n, N, float(n)/N, vqn.size());
+      swap(vq, vqn); vqn.clear();
+      sort(vq.begin(), vq.end());
+      if (float(n)/N <= o.tolerance) break;
+    }
+  }, o.repeat);
+  vector<size_t> aoff;
+  vector<pair<K, V>> alab;
+  if (o.saveLabelsets) copraCompactLabelsetsW(aoff, alab, vcom);
+  CopraResult<K, V> a(copraBestCommunities(vcom), move(aoff), move(alab), l, t);
+  a.setupTime = ts / o.repeat;
+  return a;
+}
+
+
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, class G, class Q, class FA>
+inline auto copraSeqWorklist(const G& x, const Q* q, const CopraOptions& o, FA fa) {
+  using K = typename G::key_type;
+  using V = typename G::edge_value_type;
+  CopraWorkspace<K, V, LABELSETS<K, V, LABELS>> w;
+  return copraSeqWorklistW(w, x, q, o, fa);
+}
+
+
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, class G, class Q>
+inline auto copraSeqWorklistStatic(const G& x, const Q* q=nullptr, const CopraOptions& o={}) {
+  auto fa = [](auto u) { return true; };
+  return copraSeqWorklist<LABELS, LABELSETS>(x, q, o, fa);
+}
+
+
+/**
+ * Update overlapping communities upon a batch update, using dynamic frontier with a worklist.
+ * @param x updated graph
+ * @param deletions edge deletions in this batch update (undirected, sorted by source vertex id)
+ * @param insertions edge insertions in this batch update (undirected, sorted by source vertex id)
+ * @param q previous community (vector<K>), or community set (LABELSETS) of each vertex
+ * @param o copra options
+ * @returns copra result
+ */
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, class G, class K, class V, class Q>
+inline auto copraSeqWorklistDynamicFrontier(const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const Q* q, const CopraOptions& o={}) {
+  const size_t L = LABELS;
+  K S = x.span();
+  LABELSETS<K, V, L> vcom(S);
+  copraInitializeFrom(vcom, x, *q);
+  auto vaff = copraAffectedVerticesFrontier(x, deletions, insertions, vcom);
+  auto fa = [&](auto u) { return vaff[u]==true; };
+  return copraSeqWorklist<LABELS, LABELSETS>(x, &vcom, o, fa);
 }
 
 
@@ -101,14 +410,40 @@ inline CopraResult<K> copraSeqStatic(const G& x, const vector<K>* q=nullptr, con
 // COPRA-SEQ-DYNAMIC-DELTA-SCREENING
 // ---------------------------------
 
-template <size_t LABELS=COPRA_MAX_MEMBERSHIP, class G, class K, class V>
-inline CopraResult<K> copraSeqDynamicDeltaScreening(const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const vector<K>* q, const CopraOptions& o={}) {
-  const size_t L = LABELS;
+/**
+ * Update overlapping communities upon a batch update, using delta-screening.
+ * @param w workspace with buffers to reuse (updated)
+ * @param x updated graph
+ * @param deletions edge deletions in this batch update (undirected, sorted by source vertex id)
+ * @param insertions edge insertions in this batch update (undirected, sorted by source vertex id)
+ * @param q previous community (vector<K>), or community set (LABELSETS) of each vertex (or &w.vcom, to resume)
+ * @param o copra options
+ * @returns copra result
+ */
+template <class W, class G, class K, class V, class Q>
+inline auto copraSeqDynamicDeltaScreeningW(W& w, const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const Q* q, const CopraOptions& o={}) {
+  using M = typename W::labelsets_type;
+  constexpr size_t L = tuple_size<LabelsetOf<M>>::value;
   K S = x.span();
-  const vector<Labelset<K, V, L>>& vcom = *q;
-  auto vaff = copraAffectedVerticesDeltaScreening(x, deletions, insertions, vcom);
-  auto fa   = [&](auto u) { return vaff[u]==true; };
-  return copraSeq<LABELS>(x, q, o, fa);
+  V B = copraThreshold<V>(o, L);
+  w.resizeScans(S);
+  w.resizeLabelsets(S);
+  w.resizeFlags(S, true);
+  if (w.ownsLabelsets(q)) { if (!w.freshWeights) copraUpdateVertexWeightsW(w.vtot, x, deletions, insertions); }
+  else {
+    copraVertexWeights(w.vtot, x);
+    copraInitializeFrom(w.vcom, x, *q);
+  }
+  w.freshWeights = true;
+  copraAffectedVerticesDeltaScreeningW(w.vaff, w.vneighbors, w.vcommunities, w.vcs, w.vcout, x, deletions, insertions, w.vcom, w.vtot, B);
+  auto fa = [&](auto u) { return w.vaff[u]==true; };
+  return copraSeqW(w, x, q, o, fa);
+}
+
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, class G, class K, class V, class Q>
+inline auto copraSeqDynamicDeltaScreening(const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const Q* q, const CopraOptions& o={}) {
+  CopraWorkspace<K, V, LABELSETS<K, V, LABELS>> w;
+  return copraSeqDynamicDeltaScreeningW(w, x, deletions, insertions, q, o);
 }
 
 
@@ -117,13 +452,34 @@ inline CopraResult<K> copraSeqDynamicDeltaScreening(const G& x, const vector<tup
 // COPRA-SEQ-DYNAMIC-FRONTIER
 // --------------------------
 
-template <size_t LABELS=COPRA_MAX_MEMBERSHIP, class G, class K, class V>
-inline CopraResult<K> copraSeqDynamicFrontier(const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const vector<K>* q, const CopraOptions& o={}) {
-  const size_t L = LABELS;
+/**
+ * Update overlapping communities upon a batch update, using dynamic frontier.
+ * @param w workspace with buffers to reuse (updated)
+ * @param x updated graph
+ * @param deletions edge deletions in this batch update (undirected, sorted by source vertex id)
+ * @param insertions edge insertions in this batch update (undirected, sorted by source vertex id)
+ * @param q previous community (vector<K>), or community set (LABELSETS) of each vertex (or &w.vcom, to resume)
+ * @param o copra options
+ * @returns copra result
+ */
+template <class W, class G, class K, class V, class Q>
+inline auto copraSeqDynamicFrontierW(W& w, const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const Q* q, const CopraOptions& o={}) {
   K S = x.span();
-  const vector<Labelset<K, V, L>>& vcom = *q;
-  auto vaff = copraAffectedVerticesFrontier(x, deletions, insertions, vcom);
-  auto fa = [&](auto u) { return vaff[u]==true; };
-  auto fp = [&](auto u) { x.forEachEdgeKey(u, [&](auto v) { vaff[v] = true; }); };
-  return copraSeq<LABELS>(x, q, o, fa, fp);
+  w.resizeLabelsets(S);
+  w.resizeFlags(S);
+  if (w.ownsLabelsets(q)) {
+    if (!w.freshWeights) copraUpdateVertexWeightsW(w.vtot, x, deletions, insertions);
+    w.freshWeights = true;
+  }
+  else copraInitializeFrom(w.vcom, x, *q);
+  copraAffectedVerticesFrontierW(w.vaff, x, deletions, insertions, w.vcom);
+  auto fa = [&](auto u) { return w.vaff[u]==true; };
+  auto fp = [&](auto u) { x.forEachEdgeKey(u, [&](auto v) { w.vaff[v] = true; }); };
+  return copraSeqW(w, x, q, o, fa, fp);
+}
+
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, class G, class K, class V, class Q>
+inline auto copraSeqDynamicFrontier(const G& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, V>>& insertions, const Q* q, const CopraOptions& o={}) {
+  CopraWorkspace<K, V, LABELSETS<K, V, LABELS>> w;
+  return copraSeqDynamicFrontierW(w, x, deletions, insertions, q, o);
 }
@@ -0,0 +1,161 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <future>
+#include <algorithm>
+#include "_main.hxx"
+#include "bin.hxx"
+#include "copra.hxx"
+#include "copraSeq.hxx"
+
+using std::vector;
+using std::future;
+using std::async;
+using std::launch;
+using std::swap;
+using std::max;
+using std::move;
+
+
+
+
+// COPRA-STREAM-RESULT
+// -------------------
+
+struct CopraStreamStats {
+  size_t partitions = 0;   // number of partitions
+  size_t maxBytes   = 0;   // largest partition resident at once (bytes)
+  size_t bytesRead  = 0;   // bytes read in all passes over the graph
+  float  readTime   = 0;   // time spent reading partitions, mostly overlapped with compute (ms)
+  float  waitTime   = 0;   // time spent waiting for a partition to be read (ms)
+  float  computeTime = 0;  // time spent processing partitions (ms)
+};
+
+
+template <class K, class V=float>
+struct CopraStreamResult {
+  CopraResult<K, V> result;
+  CopraStreamStats  stats;   // per repeat
+};
+
+
+
+
+// COPRA-STREAM-PARTITIONS
+// -----------------------
+// Each partition is processed while the next is read, on another thread.
+
+/**
+ * Process each partition of a binary snapshot in order, reading the next one ahead.
+ * @param s binary snapshot stream
+ * @param ps first vertex of each partition, followed by span (see BinStream::partitions())
+ * @param pa partition buffer (scratch)
+ * @param pb another partition buffer (scratch)
+ * @param st stream statistics (updated)
+ * @param fn called with each partition (x)
+ */
+template <class S, class K, class P, class F>
+void copraStreamPartitions(const S& s, const vector<K>& ps, P& pa, P& pb, CopraStreamStats& st, F fn) {
+  size_t n = ps.size()-1;
+  auto fr = [&](P& p, size_t i) {
+    auto t0 = timeNow();
+    s.readPartitionW(p, ps[i], ps[i+1]);
+    return durationMilliseconds(t0, timeNow());
+  };
+  if (n==0) return;
+  auto tw = timeNow();
+  st.readTime += fr(pa, 0);
+  st.waitTime += durationMilliseconds(tw, timeNow());
+  for (size_t i=0; i<n; ++i) {
+    future<float> next;
+    if (i+1<n) next = async(launch::async, [&, i]() { return fr(pb, i+1); });
+    auto t0 = timeNow();
+    fn(pa);
+    auto t1 = timeNow();
+    st.computeTime += durationMilliseconds(t0, t1);
+    st.bytesRead   += pa.bytes();
+    st.maxBytes     = max(st.maxBytes, pa.bytes());
+    if (i+1==n) break;
+    st.readTime += next.get();
+    st.waitTime += durationMilliseconds(t1, timeNow());
+    swap(pa, pb);
+  }
+}
+
+
+
+
+// COPRA-SEQ-STREAM
+// ----------------
+// Only community sets, vertex weights, scan buffers, and two partitions are resident.
+// With hashScan, scan buffers are also bounded by the largest degree.
+
+/**
+ * Find overlapping communities using COPRA, on a single thread, streaming the graph from a binary snapshot.
+ * Vertices are processed in the same order as copraSeqStatic(), so results are the same.
+ * @param s binary snapshot stream
+ * @param o copra options (convergence, stableIterations, and computeModularity are ignored)
+ * @param M maximum number of edges in a partition
+ * @returns copra result, and stream statistics
+ */
+template <size_t LABELS=COPRA_MAX_MEMBERSHIP, template <class, class, size_t> class LABELSETS=LabelsetVector, class K, class E, class O>
+auto copraSeqStream(const BinStream<K, E, O>& s, const CopraOptions& o, size_t M) {
+  using V = E;
+  const size_t L = LABELS;
+  int l = 0;
+  K S = s.span();
+  K N = s.order();
+  V B = copraThreshold<V>(o, L);
+  vector<K> vcs;
+  vector<V> vcout(o.hashScan? 0 : S), vtot(S);
+  CopraScanTable<K, V> vtab;
+  LABELSETS<K, V, L> vcom(S), vcon(o.synchronous? S : 0);
+  BinPartition<K, E, O> pa, pb;
+  CopraStreamStats st;
+  CopraIterationTrace tr;
+  auto fa = [](auto u) { return true; };
+  auto fp = [](auto u) {};
+  auto fc = [](auto u, const auto& labs, const auto& labn) {};
+  auto ps = s.partitions(M);
+  float ts = 0;
+  float t = measureDuration([&]() {
+    // First pass finds vertex weights, and initial communities.
+    auto t0 = timeNow();
+    copraStreamPartitions(s, ps, pa, pb, st, [&](const auto& x) {
+      if (o.unweighted) copraVertexWeights<true>(vtot, x); else copraVertexWeights(vtot, x);
+      copraInitialize(vcom, x);
+    });
+    ts += durationMilliseconds(t0, timeNow());
+    for (l=0; l<o.maxIterations;) {
+      uint64_t r = copraTieSalt(o.seed, l);
+      K n = K();
+      auto fi = [&](auto& vcon, auto& vcout) {
+        copraStreamPartitions(s, ps, pa, pb, st, [&](const auto& x) {
+          n += o.fullSort? copraMoveIteration<true>(vcs, vcout, vcon, vcom, x, vtot, B, r, fa, fp, fc, tr) : copraDispatchTraits(o, [&](auto UW, auto SL) {
+            constexpr bool UNWEIGHTED = decltype(UW)::value, SELF = decltype(SL)::value;
+            return copraMoveIteration<false, false, UNWEIGHTED, SELF>(vcs, vcout, vcon, vcom, x, vtot, B, r, fa, fp, fc, tr);
+          });
+        });
+      };
+      auto fj = [&](auto& vcout) { if (o.synchronous) fi(vcon, vcout); else fi(vcom, vcout); };
+      if (o.hashScan) fj(vtab);
+      else fj(vcout);
+      ++l;
+      if (o.synchronous) swap(vcom, vcon);
+      PRINTFD("copraSeqStream(): l=%d, n=%d, N=%d, n/N=%f\n", l, n, N, float(n)/N);
+      if (float(n)/N <= o.tolerance) break;
+    }
+  }, o.repeat);
+  vector<size_t> aoff;
+  vector<pair<K, V>> alab;
+  if (o.saveLabelsets) copraCompactLabelsetsW(aoff, alab, vcom);
+  CopraResult<K, V> a(copraBestCommunities(vcom), move(aoff), move(alab), l, t);
+  a.setupTime = ts / o.repeat;
+  st.partitions   = ps.size()-1;
+  st.bytesRead   /= o.repeat;
+  st.readTime    /= o.repeat;
+  st.waitTime    /= o.repeat;
+  st.computeTime /= o.repeat;
+  return CopraStreamResult<K, V> {move(a), st};
+}
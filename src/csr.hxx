@@ -1,13 +1,19 @@
 #pragma once
 #include <numeric>
 #include <algorithm>
+#include <utility>
 #include <vector>
 #include "_main.hxx"
+#include "Graph.hxx"
 
+using std::pair;
 using std::vector;
 using std::iota;
 using std::equal;
 using std::transform;
+using std::sort;
+using std::move;
+using std::max;
 
 
 
@@ -197,3 +203,136 @@ inline V csrSumEdgeValues(const vector<K>& xv, const vector<K>& xd, const vector
   const K *_xd = xd.empty()? nullptr : xd.data();
   return csrSumEdgeValues(xv.data(), _xd, xw.data(), K(xv.size()-1));
 }
+
+
+
+
+// GRAPH-CSR
+// ---------
+// Convert a graph to a read-only CSR graph, keeping vertex keys as is.
+
+template <class K, class V, class E, class O, class G>
+void graphCsrW(DiGraphCsr<K, V, E, O>& a, const G& x) {
+  K S = x.span();
+  a.clear();
+  a.resize(S, x.size());
+  a.offsets = sourceOffsetsAs(x, rangeIterable(S), O());
+  x.forEachVertex([&](auto u, auto d) {
+    O i = a.offsets[u];
+    a.vexists[u] = true;
+    a.vvalues[u] = d;
+    x.forEachEdge(u, [&](auto v, auto w) {
+      a.ekeys[i]   = v;
+      a.evalues[i] = w; ++i;
+    });
+  });
+  a.N = x.order();
+}
+
+template <class G>
+inline auto graphCsr(const G& x) {
+  using K = typename G::key_type;
+  using V = typename G::vertex_value_type;
+  using E = typename G::edge_value_type;
+  DiGraphCsr<K, V, E> a; graphCsrW(a, x);
+  return a;
+}
+
+
+/**
+ * Sort edges of each vertex of a CSR graph, and optionally remove duplicates.
+ * Edges are sorted by target, and then by weight, so that the result does not
+ * depend on the order in which edges were scattered (by multiple threads).
+ * @param a CSR graph (updated)
+ * @param unq remove duplicate edges? (largest weight is kept)
+ */
+template <class K, class V, class E, class O>
+void graphCsrCorrectOmpU(DiGraphCsr<K, V, E, O>& a, bool unq=false) {
+  K S = a.span();
+  vector<O> deg(S+1);
+  // Sort edges of each vertex, and count unique ones.
+  #pragma omp parallel
+  {
+    vector<pair<K, E>> buf;
+    #pragma omp for schedule(dynamic, 2048)
+    for (K u=0; u<S; ++u) {
+      O ib = a.offsets[u], ie = a.offsets[u+1];
+      buf.clear();
+      for (O j=ib; j<ie; ++j)
+        buf.push_back({a.ekeys[j], a.evalues[j]});
+      sort(buf.begin(), buf.end());
+      O n = ib;
+      for (size_t j=0; j<buf.size(); ++j) {
+        if (unq && n>ib && a.ekeys[n-1]==buf[j].first) { a.evalues[n-1] = buf[j].second; continue; }
+        a.ekeys[n]   = buf[j].first;
+        a.evalues[n] = buf[j].second; ++n;
+      }
+      deg[u] = n - ib;
+    }
+  }
+  // Remove gaps left by duplicate edges.
+  deg[S] = 0;
+  exclusiveScanW(deg, deg);
+  if (deg[S] != a.offsets[S]) {
+    vector<K> ekeys(deg[S]);
+    vector<E> evalues(deg[S]);
+    #pragma omp parallel for schedule(dynamic, 2048)
+    for (K u=0; u<S; ++u) {
+      for (O j=a.offsets[u], k=deg[u]; k<deg[u+1]; ++j, ++k) {
+        ekeys[k]   = a.ekeys[j];
+        evalues[k] = a.evalues[j];
+      }
+    }
+    a.ekeys   = move(ekeys);
+    a.evalues = move(evalues);
+    a.offsets = move(deg);
+  }
+}
+
+
+
+
+// GRAPH-CSR-SLACK
+// ---------------
+// Spare capacity of each row is a fraction of its degree, and at least a few
+// edges, so that small batch updates rarely have to move a row.
+
+/**
+ * Convert a CSR graph to one with spare capacity at the end of each row.
+ * @param a CSR graph with slack (output)
+ * @param x original graph
+ * @param f spare capacity of each row, as a fraction of its degree
+ * @param m minimum spare capacity of each row
+ */
+template <class K, class V, class E, class O>
+void graphCsrSlackOmpW(DiGraphCsrSlack<K, V, E, O>& a, const DiGraphCsr<K, V, E, O>& x, float f=0.25f, O m=4) {
+  K S = x.span();
+  a.clear();
+  a.resize(S, 0);
+  #pragma omp parallel for schedule(auto)
+  for (K u=0; u<S; ++u) {
+    O d = O(x.degree(u));
+    a.degrees[u]    = d;
+    a.capacities[u] = d + max(O(f*d), m);
+    a.offsets[u]    = a.capacities[u];
+  }
+  a.offsets[S] = 0;
+  exclusiveScanW(a.offsets, a.offsets);
+  a.ekeys.resize(a.offsets[S]);
+  a.evalues.resize(a.offsets[S]);
+  #pragma omp parallel for schedule(dynamic, 2048)
+  for (K u=0; u<S; ++u) {
+    auto [ib, ie] = x.edgeRange(u);
+    for (O i=ib, j=a.offsets[u]; i<ie; ++i, ++j) {
+      a.ekeys[j]   = x.ekeys[i];
+      a.evalues[j] = x.evalues[i];
+    }
+  }
+  // Flags in vector<bool> are bit-packed, so are not written concurrently.
+  for (K u=0; u<S; ++u) {
+    a.vexists[u] = x.vexists[u];
+    a.vvalues[u] = x.vvalues[u];
+  }
+  a.N = x.order();
+  a.M = x.size();
+}
@@ -3,6 +3,7 @@
 #include "_main.hxx"
 #include "Graph.hxx"
 #include "mtx.hxx"
+#include "bin.hxx"
 #include "snap.hxx"
 #include "vertices.hxx"
 #include "edges.hxx"
@@ -15,5 +16,12 @@
 #include "properties.hxx"
 #include "modularity.hxx"
 #include "random.hxx"
+#include "update.hxx"
+#include "reorder.hxx"
 #include "copra.hxx"
 #include "copraSeq.hxx"
+#include "copraOmp.hxx"
+#include "copraMulti.hxx"
+#include "copraStream.hxx"
+#include "copraCommunities.hxx"
+#include "sweep.hxx"
@@ -1,6 +1,7 @@
 #pragma once
 #include <cmath>
 #include <vector>
+#include <omp.h>
 #include "_main.hxx"
 
 using std::pow;
@@ -58,7 +59,7 @@ template <class G, class FC, class T>
 auto modularityBy(const G& x, FC fc, T M, T R=T(1)) {
   ASSERT(M>T() && R>T());
   size_t S = x.span();
-  vector<T> cin(S), ctot(S);
+  vector<double> cin(S), ctot(S);
   x.forEachVertexKey([&](auto u) {
     size_t c = fc(u);
     x.forEachEdge(u, [&](auto v, auto w) {
@@ -67,9 +68,95 @@ auto modularityBy(const G& x, FC fc, T M, T R=T(1)) {
       ctot[c] += w;
     });
   });
-  return modularityCommunities(cin, ctot, M, R);
+  return T(modularityCommunities(cin, ctot, double(M), double(R)));
 }
 
+template <class G, class FC, class T>
+auto modularityByOmp(const G& x, FC fc, T M, T R=T(1)) {
+  using K = typename G::key_type;
+  ASSERT(M>T() && R>T());
+  K S = x.span();
+  int H = omp_get_max_threads();
+  // Only the total weight within communities is needed, which is a scalar
+  // reduction. Total weight of each community is summed per thread, and
+  // then merged, to avoid atomics (this needs S values per thread). Sums are
+  // kept in double, as a float sum stops growing at 2^24 (and would then
+  // depend on the number of threads).
+  vector<vector<double>*> ctots(H);
+  double cin = 0;
+  #pragma omp parallel reduction(+:cin)
+  {
+    int t = omp_get_thread_num();
+    ctots[t] = new vector<double>(S);
+    vector<double>& ctot = *ctots[t];
+    #pragma omp for schedule(dynamic, 2048)
+    for (K u=0; u<S; ++u) {
+      if (!x.hasVertex(u)) continue;
+      size_t c = fc(u);
+      x.forEachEdge(u, [&](auto v, auto w) {
+        size_t d = fc(v);
+        if (c==d) cin += w;
+        ctot[c] += w;
+      });
+    }
+  }
+  double a = 0;
+  #pragma omp parallel for schedule(auto) reduction(+:a)
+  for (K c=0; c<S; ++c) {
+    double ctot = 0;
+    for (int t=0; t<H; ++t)
+      ctot += (*ctots[t])[c];
+    a += ctot*ctot;
+  }
+  for (int t=0; t<H; ++t)
+    delete ctots[t];
+  double m = M, r = R;
+  return T(cin/(2*m) - r*a/(4*m*m));
+}
+
+
+/**
+ * Find the overlapping modularity of a graph, based on community set function.
+ * An edge (u, v) lies within communities by the sum of b_u(c) b_v(c) over
+ * communities C, and total weight of C is the sum of b_u(c) K_u over vertices.
+ * With a single community per vertex, this is the same as modularity.
+ * @param x original graph
+ * @param fb community set of each vertex, as (community, belonging coefficient) pairs (u)
+ * @param M total weight of "undirected" graph (1/2 of directed graph)
+ * @param R resolution (0, 1]
+ * @returns overlapping modularity [-0.5, 1]
+ * @note pairs with a zero belonging coefficient end a community set
+ */
+template <class G, class FB, class T>
+auto modularityOverlapBy(const G& x, FB fb, T M, T R=T(1)) {
+  ASSERT(M>T() && R>T());
+  size_t S = x.span();
+  vector<double> ctot(S);
+  double cin = 0;
+  x.forEachVertexKey([&](auto u) {
+    auto bu = fb(u);
+    double ku = 0;
+    x.forEachEdge(u, [&](auto v, auto w) {
+      auto bv = fb(v);
+      ku += w;
+      for (const auto& [c, b] : bu) {
+        if (!b) break;
+        for (const auto& [d, e] : bv) {
+          if (!e) break;
+          if (c==d) cin += w*b*e;
+        }
+      }
+    });
+    for (const auto& [c, b] : bu) {
+      if (!b) break;
+      ctot[c] += b*ku;
+    }
+  });
+  double m = M, r = R;
+  return T(cin/(2*m) - r*sumSqrValues(ctot)/(4*m*m));
+}
+
+
 /**
  * Find the modularity of a graph, where each vertex is its own community.
  * @param x original graph
@@ -1,19 +1,27 @@
 #pragma once
+#include <utility>
 #include <string>
 #include <istream>
 #include <sstream>
 #include <fstream>
 #include <algorithm>
+#include <vector>
+#include <omp.h>
 #include "_main.hxx"
 #include "Graph.hxx"
+#include "csr.hxx"
 
+using std::pair;
 using std::string;
 using std::istream;
 using std::stringstream;
 using std::ifstream;
 using std::ofstream;
+using std::vector;
 using std::getline;
 using std::max;
+using std::sort;
+using std::move;
 
 
 
@@ -97,6 +105,135 @@ READ_MTX_RETURN(Graph, false)
 
 
 
+// READ-MTX-OMP
+// ------------
+// Memory-maps the file, and parses line-aligned chunks of it in parallel.
+
+/**
+ * Read the header and size line of a Matrix Market file.
+ * @param sym is the matrix symmetric? (output)
+ * @param rows number of rows (output)
+ * @param cols number of columns (output)
+ * @param size number of non-zero entries (output)
+ * @param x start of file text
+ * @param e end of file text
+ * @returns start of the first edge line (null, if not a coordinate matrix)
+ */
+inline const char* readMtxHeaderW(bool& sym, size_t& rows, size_t& cols, size_t& size, const char *x, const char *e) {
+  string h0, h1, h2, h3, h4;
+  for (; x<e && *x=='%'; x=skipLine(x, e)) {
+    if (x+1>=e || x[1]!='%') continue;
+    stringstream ls(string(x, skipLine(x, e)));
+    ls >> h0 >> h1 >> h2 >> h3 >> h4;
+  }
+  if (h1!="matrix" || h2!="coordinate") return nullptr;
+  sym = h4=="symmetric" || h4=="skew-symmetric";
+  stringstream ls(string(x, skipLine(x, e)));
+  ls >> rows >> cols >> size;
+  return skipLine(x, e);
+}
+
+
+/**
+ * Parse edge lines of a Matrix Market file (from, to, weight).
+ * @param x start of edge lines
+ * @param e end of edge lines
+ * @param sym is the matrix symmetric?
+ * @param fe called with each edge (u, v, w)
+ */
+template <class FE>
+void readMtxEdgesDo(const char *x, const char *e, bool sym, FE fe) {
+  for (; x<e; x=skipLine(x, e)) {
+    size_t u, v;
+    double w = 1;
+    const char *p = skipBlank(x, e);
+    if ((x = parseUnsignedW(u, p, e))==p) continue;
+    p = skipBlank(x, e);
+    if ((x = parseUnsignedW(v, p, e))==p) continue;
+    p = skipBlank(x, e);
+    if (p<e && *p!='\n') x = parseRealW(w, p, e);
+    fe(u, v, w);
+    if (sym) fe(v, u, w);
+  }
+}
+
+
+/**
+ * Find the start of a line-aligned chunk of text.
+ * @param x start of text
+ * @param e end of text
+ * @param i chunk number
+ * @param P number of chunks
+ * @returns start of chunk i (end, if i==P)
+ */
+inline const char* readMtxChunkBegin(const char *x, const char *e, size_t i, size_t P) {
+  if (i==0) return x;
+  if (i>=P) return e;
+  return skipLine(x + (e-x)*i/P - 1, e);
+}
+
+
+/**
+ * Read a Matrix Market file into a CSR graph, using multiple threads.
+ * @param a output graph (updated)
+ * @param pth path to file
+ * @param unq remove duplicate edges? (always, if SYMMETRIC)
+ * @returns true if the graph was read (false, if the file cannot be opened, or is not a coordinate matrix)
+ * @note with SYMMETRIC, the reverse of each edge is added as well
+ */
+template <bool SYMMETRIC=false, class K, class V, class E, class O>
+bool readMtxOmpW(DiGraphCsr<K, V, E, O>& a, const char *pth, bool unq=false) {
+  a.clear();
+  MappedFile f(pth);
+  if (!f) return false;
+  bool sym = false;
+  size_t r = 0, c = 0, sz = 0;
+  const char *e = f.data() + f.size();
+  const char *b = readMtxHeaderW(sym, r, c, sz, f.data(), e);
+  if (!b) return false;
+  if (SYMMETRIC) { sym = true; unq = true; }
+  size_t S = max(r, c) + 1;
+  size_t P = 16 * omp_get_max_threads();
+  a.resize(S, 0);
+  // Count the degree of each vertex.
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (size_t i=0; i<P; ++i) {
+    const char *cb = readMtxChunkBegin(b, e, i,   P);
+    const char *ce = readMtxChunkBegin(b, e, i+1, P);
+    readMtxEdgesDo(cb, ce, sym, [&](auto u, auto v, auto w) {
+      if (u>=S || v>=S) return;
+      #pragma omp atomic
+      ++a.offsets[u];
+    });
+  }
+  exclusiveScanW(a.offsets, a.offsets);
+  // Scatter edges to their source vertex.
+  vector<O> ptr(a.offsets.begin(), a.offsets.end()-1);
+  a.ekeys.resize(a.offsets[S]);
+  a.evalues.resize(a.offsets[S]);
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (size_t i=0; i<P; ++i) {
+    const char *cb = readMtxChunkBegin(b, e, i,   P);
+    const char *ce = readMtxChunkBegin(b, e, i+1, P);
+    readMtxEdgesDo(cb, ce, sym, [&](auto u, auto v, auto w) {
+      if (u>=S || v>=S) return;
+      O j;
+      #pragma omp atomic capture
+      j = ptr[u]++;
+      a.ekeys[j]   = K(v);
+      a.evalues[j] = E(w);
+    });
+  }
+  graphCsrCorrectOmpU(a, unq);
+  for (size_t u=1; u<S; ++u)
+    a.vexists[u] = true;
+  a.N = S-1;
+  return true;
+}
+
+
+
+
 // WRITE-MTX
 // ---------
 
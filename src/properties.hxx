@@ -1,8 +1,10 @@
 #pragma once
 #include <tuple>
+#include <type_traits>
 #include "vertices.hxx"
 
 using std::make_tuple;
+using std::is_same;
 
 
 
@@ -110,3 +112,44 @@ auto edgeWeight(const G& x) {
   x.forEachVertexKey([&](auto u) { a += edgeWeight(x, u); });
   return a;
 }
+
+
+
+
+// IS-UNWEIGHTED
+// -------------
+
+/**
+ * Examine if all edges of a graph have unit weight.
+ * @param x original graph
+ * @returns is every edge weight 1 (always, if edges have no values)?
+ */
+template <class G>
+bool isUnweighted(const G& x) {
+  using E = typename G::edge_value_type;
+  if constexpr (is_same<E, None>::value) return true;
+  else {
+    bool a = true;
+    x.forEachVertexKey([&](auto u) {
+      if (a) x.forEachEdgeValue(u, [&](auto w) { if (w!=E(1)) a = false; });
+    });
+    return a;
+  }
+}
+
+template <class G>
+bool isUnweightedOmp(const G& x) {
+  using K = typename G::key_type;
+  using E = typename G::edge_value_type;
+  if constexpr (is_same<E, None>::value) return true;
+  else {
+    K S = x.span();
+    bool a = true;
+    #pragma omp parallel for schedule(dynamic, 2048) reduction(&&:a)
+    for (K u=0; u<S; ++u) {
+      if (!x.hasVertex(u)) continue;
+      x.forEachEdgeValue(u, [&](auto w) { if (w!=E(1)) a = false; });
+    }
+    return a;
+  }
+}
@@ -1,3 +1,4 @@
+#pragma once
 #include <random>
 
 using std::uniform_real_distribution;
@@ -0,0 +1,243 @@
+#pragma once
+#include <utility>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <omp.h>
+#include "_main.hxx"
+#include "Graph.hxx"
+
+using std::pair;
+using std::string;
+using std::vector;
+using std::sort;
+using std::stable_sort;
+using std::reverse;
+
+
+
+
+// VERTEX-ORDER
+// ------------
+// Orders of vertices for locality, listed as the old id of each new id.
+// Vertices which do not exist are kept at the end, in order of id.
+
+/**
+ * Append vertices which do not exist to a vertex order.
+ * @param ks vertex order (updated)
+ * @param x original graph
+ */
+template <class G, class K>
+inline void appendMissingVertices(vector<K>& ks, const G& x) {
+  K S = x.span();
+  for (K u=0; u<S; ++u)
+    if (!x.hasVertex(u)) ks.push_back(u);
+}
+
+
+/**
+ * Order vertices by decreasing degree, so that hubs are stored together.
+ * @param x original graph
+ * @returns old id of each new id
+ */
+template <class G>
+auto degreeOrder(const G& x) {
+  using K = typename G::key_type;
+  vector<K> ks;
+  ks.reserve(x.span());
+  x.forEachVertexKey([&](auto u) { ks.push_back(u); });
+  stable_sort(ks.begin(), ks.end(), [&](K u, K v) { return x.degree(u) > x.degree(v); });
+  appendMissingVertices(ks, x);
+  return ks;
+}
+
+
+/**
+ * Order vertices by breadth-first search, from each unvisited vertex in order of id.
+ * @param x original graph
+ * @returns old id of each new id
+ */
+template <class G>
+auto bfsOrder(const G& x) {
+  using K = typename G::key_type;
+  K S = x.span();
+  vector<K> ks;
+  vector<bool> vis(S);
+  ks.reserve(S);
+  // The order itself is the queue of the search.
+  x.forEachVertexKey([&](auto s) {
+    if (vis[s]) return;
+    vis[s] = true;
+    ks.push_back(s);
+    for (size_t i=ks.size()-1; i<ks.size(); ++i) {
+      x.forEachEdgeKey(ks[i], [&](auto v) {
+        if (vis[v]) return;
+        vis[v] = true;
+        ks.push_back(v);
+      });
+    }
+  });
+  appendMissingVertices(ks, x);
+  return ks;
+}
+
+
+/**
+ * Order vertices by Reverse Cuthill-McKee, to reduce the bandwidth of the graph.
+ * Each component is searched from its vertex with least degree, instead of a
+ * pseudo-peripheral vertex, and neighbors are visited in order of degree.
+ * @param x original graph (symmetric)
+ * @returns old id of each new id
+ */
+template <class G>
+auto rcmOrder(const G& x) {
+  using K = typename G::key_type;
+  K S = x.span();
+  vector<K> ks, vs;
+  vector<bool> vis(S);
+  ks.reserve(S);
+  vs.reserve(S);
+  auto fl = [&](K u, K v) { return x.degree(u) < x.degree(v); };
+  x.forEachVertexKey([&](auto u) { vs.push_back(u); });
+  stable_sort(vs.begin(), vs.end(), fl);
+  for (K s : vs) {
+    if (vis[s]) continue;
+    vis[s] = true;
+    ks.push_back(s);
+    for (size_t i=ks.size()-1; i<ks.size(); ++i) {
+      size_t j = ks.size();
+      x.forEachEdgeKey(ks[i], [&](auto v) {
+        if (vis[v]) return;
+        vis[v] = true;
+        ks.push_back(v);
+      });
+      stable_sort(ks.begin()+j, ks.end(), fl);
+    }
+  }
+  reverse(ks.begin(), ks.end());
+  appendMissingVertices(ks, x);
+  return ks;
+}
+
+
+/**
+ * Order vertices by a named method.
+ * @param x original graph
+ * @param order degree, bfs, or rcm (otherwise, the order of ids)
+ * @returns old id of each new id
+ */
+template <class G>
+auto vertexOrder(const G& x, const string& order) {
+  using K = typename G::key_type;
+  if (order=="degree") return degreeOrder(x);
+  if (order=="bfs")    return bfsOrder(x);
+  if (order=="rcm")    return rcmOrder(x);
+  vector<K> ks(x.span());
+  for (K u=0; u<x.span(); ++u)
+    ks[u] = u;
+  return ks;
+}
+
+
+/**
+ * Check if a vertex order is known.
+ * @param order name of vertex order
+ * @returns is it none, degree, bfs, or rcm?
+ */
+inline bool isVertexOrder(const string& order) {
+  return order=="none" || order=="degree" || order=="bfs" || order=="rcm";
+}
+
+
+/**
+ * Find the new id of each old id, from a vertex order.
+ * @param ks old id of each new id
+ * @returns new id of each old id
+ */
+template <class K>
+inline vector<K> inverseOrder(const vector<K>& ks) {
+  vector<K> a(ks.size());
+  for (size_t i=0; i<ks.size(); ++i)
+    a[ks[i]] = K(i);
+  return a;
+}
+
+
+
+
+// RELABEL-VERTICES
+// ----------------
+// Edges of each vertex are sorted by new id, as in the original graph.
+
+/**
+ * Write edges of a vertex to a relabeled graph.
+ * @param a relabeled graph (updated)
+ * @param es buffer for edges (scratch)
+ * @param x original graph
+ * @param vnew new id of each old id
+ * @param u old id of vertex
+ * @param i offset of its edges in relabeled graph
+ */
+template <class K, class V, class E, class O>
+inline void relabelEdgesW(DiGraphCsr<K, V, E, O>& a, vector<pair<K, E>>& es, const DiGraphCsr<K, V, E, O>& x, const vector<K>& vnew, K u, O i) {
+  es.clear();
+  x.forEachEdge(u, [&](auto v, auto w) { es.push_back({vnew[v], w}); });
+  sort(es.begin(), es.end(), [](const auto& p, const auto& q) { return p.first < q.first; });
+  for (const auto& [v, w] : es) {
+    a.ekeys[i] = v; a.evalues[i++] = w;
+  }
+}
+
+
+/**
+ * Relabel vertices of a CSR graph.
+ * @param a relabeled graph (output)
+ * @param x original graph
+ * @param ks old id of each new id (see degreeOrder(), bfsOrder(), rcmOrder())
+ */
+template <class K, class V, class E, class O>
+void relabelVerticesW(DiGraphCsr<K, V, E, O>& a, const DiGraphCsr<K, V, E, O>& x, const vector<K>& ks) {
+  K S = x.span();
+  vector<K> vnew = inverseOrder(ks);
+  vector<pair<K, E>> es;
+  a.clear();
+  a.resize(S, x.size());
+  for (K i=0; i<S; ++i)
+    a.offsets[i] = x.degree(ks[i]);
+  a.offsets[S] = 0;
+  exclusiveScanW(a.offsets, a.offsets);
+  for (K i=0; i<S; ++i) {
+    relabelEdgesW(a, es, x, vnew, ks[i], a.offsets[i]);
+    a.vexists[i] = x.vexists[ks[i]];
+    a.vvalues[i] = x.vvalues[ks[i]];
+  }
+  a.N = x.order();
+}
+
+template <class K, class V, class E, class O>
+void relabelVerticesOmpW(DiGraphCsr<K, V, E, O>& a, const DiGraphCsr<K, V, E, O>& x, const vector<K>& ks) {
+  K S = x.span();
+  vector<K> vnew(S);
+  a.clear();
+  a.resize(S, x.size());
+  #pragma omp parallel for schedule(static, 2048)
+  for (K i=0; i<S; ++i) {
+    vnew[ks[i]] = i;
+    a.offsets[i] = x.degree(ks[i]);
+  }
+  a.offsets[S] = 0;
+  exclusiveScanW(a.offsets, a.offsets);
+  #pragma omp parallel
+  {
+    vector<pair<K, E>> es;
+    #pragma omp for schedule(dynamic, 2048)
+    for (K i=0; i<S; ++i)
+      relabelEdgesW(a, es, x, vnew, ks[i], a.offsets[i]);
+  }
+  // Flags in vector<bool> are bit-packed, so are not written concurrently.
+  for (K i=0; i<S; ++i) {
+    a.vexists[i] = x.vexists[ks[i]];
+    a.vvalues[i] = x.vvalues[ks[i]];
+  }
+  a.N = x.order();
+}
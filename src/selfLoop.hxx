@@ -38,6 +38,40 @@ inline auto selfLoopCount(const G& x) {
 
 
 
+// HAS-SELF-LOOPS
+// --------------
+// Scans edges, so rows need not be sorted.
+
+/**
+ * Examine if any vertex of a graph has a self-loop.
+ * @param x original graph
+ * @returns is there an edge u -> u?
+ */
+template <class G>
+bool hasSelfLoops(const G& x) {
+  bool a = false;
+  x.forEachVertexKey([&](auto u) {
+    if (!a) x.forEachEdgeKey(u, [&](auto v) { if (u==v) a = true; });
+  });
+  return a;
+}
+
+template <class G>
+bool hasSelfLoopsOmp(const G& x) {
+  using K = typename G::key_type;
+  K S = x.span();
+  bool a = false;
+  #pragma omp parallel for schedule(dynamic, 2048) reduction(||:a)
+  for (K u=0; u<S; ++u) {
+    if (!x.hasVertex(u)) continue;
+    x.forEachEdgeKey(u, [&](auto v) { if (u==v) a = true; });
+  }
+  return a;
+}
+
+
+
+
 // SELF-LOOPS
 // ----------
 
@@ -0,0 +1,273 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+#include "_main.hxx"
+#include "reorder.hxx"
+#include "copra.hxx"
+
+using std::string;
+using std::vector;
+using std::ostream;
+using std::sort;
+using std::sqrt;
+using std::stoi;
+using std::stof;
+using std::stoull;
+using std::logic_error;
+
+
+
+
+// SWEEP-OPTIONS
+// -------------
+// Parameter grid of a benchmark sweep, from command line arguments.
+
+struct SweepOptions {
+  vector<int>    labels     = {1, 2, 4, 8, 16, 32};
+  vector<float>  tolerances = {1e-1f, 5e-2f, 1e-2f, 5e-3f, 1e-3f, 5e-4f, 1e-4f};
+  vector<string> engines    = {"seq", "omp"};
+  int    repeat = 5;
+  int    maxIterations = 20;
+  string order = "none";  // vertex order (none, degree, bfs, rcm)
+  int    hubDegree = 0;     // split scans of vertices with a larger degree (omp, 0 = never)
+  string convergence = "label";  // convergence criterion (label, count, belonging)
+  int    stableIterations = 0;   // skip vertices stable for this many iterations (0 = never)
+  uint64_t seed = 0;             // seed for breaking ties (0 = fixed ties)
+  string csv;   // path to write CSV (optional)
+  string json;  // path to write JSON (optional)
+};
+
+
+/**
+ * Split a comma-separated list.
+ * @param x comma-separated list
+ * @returns list of values
+ */
+inline vector<string> sweepSplitList(const string& x) {
+  vector<string> a;
+  size_t i = 0;
+  while (i<=x.size()) {
+    size_t j = x.find(',', i);
+    if (j==string::npos) j = x.size();
+    if (j>i) a.push_back(x.substr(i, j-i));
+    i = j+1;
+  }
+  return a;
+}
+
+
+/**
+ * Check if an engine name is known: seq, or omp, followed by optional Sort, Sync, and Hash.
+ * @param x engine name
+ * @returns is it known?
+ */
+inline bool isSweepEngine(const string& x) {
+  for (const char *e : {"seq", "omp"})
+    for (const char *s : {"", "Sort"})
+      for (const char *y : {"", "Sync"})
+        for (const char *h : {"", "Hash"})
+          if (x==string(e) + s + y + h) return true;
+  return false;
+}
+
+
+/**
+ * Find a convergence criterion by name.
+ * @param x name of criterion (label, count, or belonging)
+ * @param a convergence criterion (output)
+ * @returns is it known?
+ */
+inline bool readSweepConvergence(const string& x, CopraConvergence& a) {
+  if (x=="label")     { a = CopraConvergence::LABEL;     return true; }
+  if (x=="count")     { a = CopraConvergence::COUNT;     return true; }
+  if (x=="belonging") { a = CopraConvergence::BELONGING; return true; }
+  return false;
+}
+
+
+/**
+ * Read sweep options from command line arguments, of the form --name=value.
+ * Lists are comma-separated, as in --labels=1,4,8 --tolerances=0.1,0.01.
+ * @param a sweep options (updated)
+ * @param argc number of arguments
+ * @param argv arguments
+ * @param i index of first argument to read
+ * @returns true if all arguments were read (false, if any is unknown, or malformed)
+ */
+inline bool readSweepOptionsW(SweepOptions& a, int argc, char **argv, int i=1) {
+  // Numbers that cannot be parsed, or are out of range, throw from stoi() and friends.
+  try {
+    for (; i<argc; ++i) {
+      string s = argv[i];
+      size_t e = s.find('=');
+      if (s.rfind("--", 0)!=0 || e==string::npos) return false;
+      string k = s.substr(2, e-2), v = s.substr(e+1);
+      auto vs = sweepSplitList(v);
+      if (k=="labels") {
+        a.labels.clear();
+        for (const auto& x : vs) a.labels.push_back(stoi(x));
+        for (int l : a.labels)
+          if (l<1) return false;
+      }
+      else if (k=="tolerances") {
+        a.tolerances.clear();
+        for (const auto& x : vs) a.tolerances.push_back(stof(x));
+      }
+      else if (k=="engines") {
+        for (const auto& x : vs)
+          if (!isSweepEngine(x)) return false;
+        a.engines = vs;
+      }
+      else if (k=="repeat")  a.repeat  = stoi(v);
+      else if (k=="max-iterations") a.maxIterations = stoi(v);
+      else if (k=="hub-degree") a.hubDegree = stoi(v);
+      else if (k=="stable-iterations") a.stableIterations = stoi(v);
+      else if (k=="seed") a.seed = stoull(v);
+      else if (k=="convergence") {
+        CopraConvergence c = CopraConvergence::LABEL;
+        if (!readSweepConvergence(v, c)) return false;
+        a.convergence = v;
+      }
+      else if (k=="order") {
+        if (!isVertexOrder(v)) return false;
+        a.order = v;
+      }
+      else if (k=="csv")  a.csv  = v;
+      else if (k=="json") a.json = v;
+      else return false;
+    }
+  }
+  catch (const logic_error&) { return false; }
+  return true;
+}
+
+
+
+
+// SWEEP-STATISTICS
+// ----------------
+
+struct SweepStatistics {
+  double median = 0;
+  double min    = 0;
+  double max    = 0;
+  double mean   = 0;
+  double stddev = 0;  // sample standard deviation
+};
+
+
+/**
+ * Find summary statistics of measurements.
+ * @param x measurements (one per repeat)
+ * @returns median, min, max, mean, and standard deviation
+ */
+template <class T>
+SweepStatistics sweepStatistics(vector<T> x) {
+  SweepStatistics a;
+  size_t N = x.size();
+  if (N==0) return a;
+  sort(x.begin(), x.end());
+  a.min    = x[0];
+  a.max    = x[N-1];
+  a.median = N%2? x[N/2] : (double(x[N/2-1]) + x[N/2])/2;
+  for (const auto& v : x)
+    a.mean += v;
+  a.mean /= N;
+  for (const auto& v : x)
+    a.stddev += (v - a.mean) * (v - a.mean);
+  a.stddev = N>1? sqrt(a.stddev / (N-1)) : 0;
+  return a;
+}
+
+
+
+
+// SWEEP-RESULT
+// ------------
+
+struct SweepResult {
+  string graph;
+  string order;
+  string engine;
+  int    labels    = 0;
+  float  tolerance = 0;
+  int    threads   = 0;
+  int    hubDegree = 0;
+  string convergence;
+  int    stableIterations = 0;
+  uint64_t seed   = 0;
+  int    repeat     = 0;
+  int    iterations = 0;   // of last repeat
+  double modularity = 0;   // of last repeat
+  float  reorderTime = 0;  // time to reorder vertices, once for all configurations (ms)
+  SweepStatistics time;           // total time (ms)
+  SweepStatistics setupTime;      // time to initialize (ms, vertex weights are precomputed)
+  SweepStatistics iterationTime;  // time spent in iterations (ms)
+};
+
+
+/**
+ * Write sweep results as CSV, with one row per configuration.
+ * @param a output stream
+ * @param x sweep results
+ */
+inline void writeSweepCsv(ostream& a, const vector<SweepResult>& x) {
+  const char *ss[] = {"time", "setupTime", "iterationTime"};
+  a << "graph,order,engine,labels,tolerance,threads,hubDegree,convergence,stableIterations,seed,repeat,iterations,modularity,reorderTime";
+  for (auto s : ss)
+    a << "," << s << "Median," << s << "Min," << s << "Max," << s << "Mean," << s << "Stddev";
+  a << "\n";
+  for (const auto& r : x) {
+    a << r.graph << "," << r.order << "," << r.engine << "," << r.labels << "," << r.tolerance << ",";
+    auto p = a.precision(9);
+    a << r.threads << "," << r.hubDegree << "," << r.convergence << "," << r.stableIterations << "," << r.seed << "," << r.repeat << "," << r.iterations << "," << r.modularity;
+    a.precision(p);
+    a << "," << r.reorderTime;
+    for (const auto *t : {&r.time, &r.setupTime, &r.iterationTime})
+      a << "," << t->median << "," << t->min << "," << t->max << "," << t->mean << "," << t->stddev;
+    a << "\n";
+  }
+}
+
+
+/**
+ * Write sweep statistics as JSON.
+ * @param a output stream
+ * @param x sweep statistics
+ */
+inline void writeSweepStatisticsJson(ostream& a, const SweepStatistics& x) {
+  a << "{\"median\":" << x.median << ",\"min\":" << x.min << ",\"max\":" << x.max;
+  a << ",\"mean\":" << x.mean << ",\"stddev\":" << x.stddev << "}";
+}
+
+
+/**
+ * Write sweep results as JSON, as an array of configurations.
+ * @param a output stream
+ * @param x sweep results
+ */
+inline void writeSweepJson(ostream& a, const vector<SweepResult>& x) {
+  a << "[";
+  for (size_t i=0; i<x.size(); ++i) {
+    const auto& r = x[i];
+    if (i>0) a << ",\n";
+    a << "{\"graph\":\"" << r.graph << "\",\"order\":\"" << r.order << "\",\"engine\":\"" << r.engine << "\"";
+    a << ",\"labels\":" << r.labels << ",\"tolerance\":" << r.tolerance;
+    a << ",\"threads\":" << r.threads << ",\"hubDegree\":" << r.hubDegree;
+    a << ",\"convergence\":\"" << r.convergence << "\",\"stableIterations\":" << r.stableIterations << ",\"seed\":" << r.seed << ",\"repeat\":" << r.repeat;
+    auto p = a.precision(9);
+    a << ",\"iterations\":" << r.iterations << ",\"modularity\":" << r.modularity;
+    a.precision(p);
+    a << ",\"reorderTime\":" << r.reorderTime;
+    a << ",\"time\":";          writeSweepStatisticsJson(a, r.time);
+    a << ",\"setupTime\":";     writeSweepStatisticsJson(a, r.setupTime);
+    a << ",\"iterationTime\":"; writeSweepStatisticsJson(a, r.iterationTime);
+    a << "}";
+  }
+  a << "]\n";
+}
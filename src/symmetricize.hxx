@@ -1,4 +1,10 @@
 #pragma once
+#include <vector>
+#include "_main.hxx"
+#include "Graph.hxx"
+#include "csr.hxx"
+
+using std::vector;
 
 
 
@@ -23,3 +29,55 @@ auto symmetricize(const G& x) {
   G a; symmetricizeW(a, x);
   return a;
 }
+
+
+/**
+ * Symmetricize a CSR graph, using multiple threads.
+ * @param a output graph (updated)
+ * @param x original graph
+ */
+template <class K, class V, class E, class O>
+void symmetricizeOmpW(DiGraphCsr<K, V, E, O>& a, const DiGraphCsr<K, V, E, O>& x) {
+  K S = x.span();
+  a.clear();
+  a.resize(S, 0);
+  // Count edges in both directions.
+  #pragma omp parallel for schedule(dynamic, 2048)
+  for (K u=0; u<S; ++u) {
+    x.forEachEdgeKey(u, [&](auto v) {
+      #pragma omp atomic
+      ++a.offsets[u];
+      #pragma omp atomic
+      ++a.offsets[v];
+    });
+  }
+  exclusiveScanW(a.offsets, a.offsets);
+  // Scatter edges in both directions.
+  vector<O> ptr(a.offsets.begin(), a.offsets.end()-1);
+  a.ekeys.resize(a.offsets[S]);
+  a.evalues.resize(a.offsets[S]);
+  #pragma omp parallel for schedule(dynamic, 2048)
+  for (K u=0; u<S; ++u) {
+    x.forEachEdge(u, [&](auto v, auto w) {
+      O i, j;
+      #pragma omp atomic capture
+      i = ptr[u]++;
+      #pragma omp atomic capture
+      j = ptr[v]++;
+      a.ekeys[i] = v; a.evalues[i] = w;
+      a.ekeys[j] = u; a.evalues[j] = w;
+    });
+  }
+  graphCsrCorrectOmpU(a, true);
+  for (K u=0; u<S; ++u) {
+    a.vexists[u] = x.vexists[u];
+    a.vvalues[u] = x.vvalues[u];
+  }
+  a.N = x.order();
+}
+
+template <class K, class V, class E, class O>
+inline auto symmetricizeOmp(const DiGraphCsr<K, V, E, O>& x) {
+  DiGraphCsr<K, V, E, O> a; symmetricizeOmpW(a, x);
+  return a;
+}
@@ -0,0 +1,308 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <tuple>
+#include <vector>
+#include <algorithm>
+#include "_main.hxx"
+#include "Graph.hxx"
+#include "random.hxx"
+
+using std::pair;
+using std::tuple;
+using std::vector;
+using std::get;
+using std::swap;
+using std::sort;
+using std::stable_sort;
+using std::unique;
+using std::lower_bound;
+
+
+
+
+// GENERATE-BATCH
+// --------------
+// Random batch updates, for benchmarking dynamic algorithms.
+// Each undirected edge is listed in both directions.
+
+/**
+ * Generate a batch of random edge deletions.
+ * @param rnd random number generator (updated)
+ * @param x original graph
+ * @param batchSize number of undirected edges to delete
+ * @returns edge deletions (undirected, not tidy)
+ */
+template <class R, class G>
+auto generateEdgeDeletions(R& rnd, const G& x, size_t batchSize) {
+  using K = typename G::key_type;
+  vector<tuple<K, K>> a;
+  a.reserve(2*batchSize);
+  size_t n = 0;
+  auto fe = [&](auto u, auto v) {
+    a.push_back({u, v});
+    if (u!=v) a.push_back({v, u});
+    ++n;
+  };
+  // Give up after a while, if the graph has too few edges.
+  for (size_t i=0; n<batchSize && i<100*batchSize; ++i)
+    removeRandomEdge(x, rnd, fe);
+  return a;
+}
+
+
+/**
+ * Generate a batch of random edge insertions, between existing vertices.
+ * @param rnd random number generator (updated)
+ * @param x original graph
+ * @param batchSize number of undirected edges to insert
+ * @param w weight of each inserted edge
+ * @returns edge insertions (undirected, not tidy)
+ */
+template <class R, class G, class E>
+auto generateEdgeInsertions(R& rnd, const G& x, size_t batchSize, E w) {
+  using K = typename G::key_type;
+  vector<tuple<K, K, E>> a;
+  a.reserve(2*batchSize);
+  size_t n = 0;
+  auto fe = [&](auto u, auto v, auto w) {
+    if (u==v || !x.hasVertex(u) || !x.hasVertex(v) || x.hasEdge(u, v)) return;
+    a.push_back({u, v, w});
+    a.push_back({v, u, w});
+    ++n;
+  };
+  for (size_t i=0; n<batchSize && i<100*batchSize; ++i)
+    addRandomEdge(x, rnd, x.span(), w, fe);
+  return a;
+}
+
+
+
+
+// TIDY-BATCH-UPDATE
+// -----------------
+
+/**
+ * Sort batch update by source, and then target vertex, and remove duplicate edges.
+ * @param deletions edge deletions (updated)
+ * @param insertions edge insertions (updated, first of duplicates is kept)
+ */
+template <class K, class E>
+void tidyBatchUpdateU(vector<tuple<K, K>>& deletions, vector<tuple<K, K, E>>& insertions) {
+  auto fl = [](const auto& p, const auto& q) { return get<0>(p)<get<0>(q) || (get<0>(p)==get<0>(q) && get<1>(p)<get<1>(q)); };
+  auto fq = [](const auto& p, const auto& q) { return get<0>(p)==get<0>(q) && get<1>(p)==get<1>(q); };
+  sort(deletions.begin(), deletions.end(), fl);
+  deletions.erase(unique(deletions.begin(), deletions.end(), fq), deletions.end());
+  stable_sort(insertions.begin(), insertions.end(), fl);
+  insertions.erase(unique(insertions.begin(), insertions.end(), fq), insertions.end());
+}
+
+template <class K, class E>
+void tidyBatchUpdateOmpU(vector<tuple<K, K>>& deletions, vector<tuple<K, K, E>>& insertions) {
+  auto fl = [](const auto& p, const auto& q) { return get<0>(p)<get<0>(q) || (get<0>(p)==get<0>(q) && get<1>(p)<get<1>(q)); };
+  auto fq = [](const auto& p, const auto& q) { return get<0>(p)==get<0>(q) && get<1>(p)==get<1>(q); };
+  vector<tuple<K, K>>    d;
+  vector<tuple<K, K, E>> i;
+  stableSortOmpU(deletions,  fl);
+  stableSortOmpU(insertions, fl);
+  uniqueOmpW(d, deletions,  fq); swap(deletions,  d);
+  uniqueOmpW(i, insertions, fq); swap(insertions, i);
+}
+
+
+
+
+// APPLY-BATCH-UPDATE
+// ------------------
+// Edges of each vertex are merged with its (sorted) batch, so that edges of
+// the updated graph are also sorted. Insertions of existing edges are ignored.
+
+/**
+ * Find the range of a batch update with a given source vertex.
+ * @param x batch update (sorted by source vertex id)
+ * @param u source vertex
+ * @returns [begin, end) indices of edges from u
+ */
+template <class T, class K>
+inline pair<size_t, size_t> batchUpdateRange(const vector<T>& x, K u) {
+  auto fl = [](const T& p, K u) { return get<0>(p) < u; };
+  size_t ib = lower_bound(x.begin(), x.end(), u, fl) - x.begin();
+  size_t ie = lower_bound(x.begin()+ib, x.end(), u+1, fl) - x.begin();
+  return {ib, ie};
+}
+
+
+/**
+ * Find source vertices of a batch update.
+ * @param a source vertices, in order (output)
+ * @param deletions edge deletions (tidy)
+ * @param insertions edge insertions (tidy)
+ */
+template <class K, class E>
+void batchUpdateSourcesW(vector<K>& a, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, E>>& insertions) {
+  size_t D = deletions.size(), I = insertions.size();
+  a.clear();
+  for (size_t i=0, j=0; i<D || j<I;) {
+    K u = j>=I || (i<D && get<0>(deletions[i]) < get<0>(insertions[j]))? get<0>(deletions[i]) : get<0>(insertions[j]);
+    a.push_back(u);
+    for (; i<D && get<0>(deletions[i])==u; ++i);
+    for (; j<I && get<0>(insertions[j])==u; ++j);
+  }
+}
+
+
+/**
+ * Go through updated edges of a vertex, in order of target vertex id.
+ * @param x original graph (edges sorted, DiGraphCsr or DiGraphCsrSlack)
+ * @param u given vertex
+ * @param deletions edge deletions (tidy)
+ * @param insertions edge insertions (tidy)
+ * @param fe called with each updated edge (v, w)
+ * @param fc called with each deleted, or inserted edge (v, w, inserted?)
+ */
+template <class G, class K, class E, class FE, class FC>
+inline void applyBatchUpdateDo(const G& x, K u, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, E>>& insertions, FE fe, FC fc) {
+  auto [jb, je] = x.edgeRange(u);
+  auto [db, de] = batchUpdateRange(deletions,  u);
+  auto [ib, ie] = batchUpdateRange(insertions, u);
+  for (auto j=jb; j<je || ib<ie;) {
+    if (ib<ie && (j>=je || get<1>(insertions[ib]) < x.ekeys[j])) {
+      fe(get<1>(insertions[ib]), get<2>(insertions[ib]));
+      fc(get<1>(insertions[ib]), get<2>(insertions[ib]), true); ++ib;
+      continue;
+    }
+    K v = x.ekeys[j];
+    if (ib<ie && get<1>(insertions[ib])==v) ++ib;
+    for (; db<de && get<1>(deletions[db]) < v; ++db);
+    if (db>=de || get<1>(deletions[db])!=v) fe(v, x.evalues[j]);
+    else fc(v, x.evalues[j], false);
+    ++j;
+  }
+}
+
+template <class G, class K, class E, class FE>
+inline void applyBatchUpdateDo(const G& x, K u, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, E>>& insertions, FE fe) {
+  applyBatchUpdateDo(x, u, deletions, insertions, fe, [](auto v, auto w, bool ins) {});
+}
+
+
+/**
+ * Apply a batch update to a CSR graph.
+ * @param a updated graph (output)
+ * @param x original graph (edges sorted)
+ * @param deletions edge deletions (tidy)
+ * @param insertions edge insertions (tidy)
+ */
+template <class K, class V, class E, class O>
+void applyBatchUpdateW(DiGraphCsr<K, V, E, O>& a, const DiGraphCsr<K, V, E, O>& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, E>>& insertions) {
+  K S = x.span();
+  a.clear();
+  a.resize(S, 0);
+  for (K u=0; u<S; ++u) {
+    O d = O();
+    applyBatchUpdateDo(x, u, deletions, insertions, [&](auto v, auto w) { ++d; });
+    a.offsets[u] = d;
+  }
+  a.offsets[S] = 0;
+  exclusiveScanW(a.offsets, a.offsets);
+  a.ekeys.resize(a.offsets[S]);
+  a.evalues.resize(a.offsets[S]);
+  for (K u=0; u<S; ++u) {
+    O i = a.offsets[u];
+    applyBatchUpdateDo(x, u, deletions, insertions, [&](auto v, auto w) { a.ekeys[i] = v; a.evalues[i++] = w; });
+    a.vexists[u] = x.vexists[u] || a.offsets[u+1]>a.offsets[u];
+    a.vvalues[u] = x.vvalues[u];
+    if (a.vexists[u]) ++a.N;
+  }
+}
+
+template <class K, class V, class E, class O>
+void applyBatchUpdateOmpW(DiGraphCsr<K, V, E, O>& a, const DiGraphCsr<K, V, E, O>& x, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, E>>& insertions) {
+  K S = x.span();
+  a.clear();
+  a.resize(S, 0);
+  #pragma omp parallel for schedule(dynamic, 2048)
+  for (K u=0; u<S; ++u) {
+    O d = O();
+    applyBatchUpdateDo(x, u, deletions, insertions, [&](auto v, auto w) { ++d; });
+    a.offsets[u] = d;
+  }
+  a.offsets[S] = 0;
+  exclusiveScanW(a.offsets, a.offsets);
+  a.ekeys.resize(a.offsets[S]);
+  a.evalues.resize(a.offsets[S]);
+  #pragma omp parallel for schedule(dynamic, 2048)
+  for (K u=0; u<S; ++u) {
+    O i = a.offsets[u];
+    applyBatchUpdateDo(x, u, deletions, insertions, [&](auto v, auto w) { a.ekeys[i] = v; a.evalues[i++] = w; });
+  }
+  // Flags in vector<bool> are bit-packed, so are not written concurrently.
+  for (K u=0; u<S; ++u) {
+    a.vexists[u] = x.vexists[u] || a.offsets[u+1]>a.offsets[u];
+    a.vvalues[u] = x.vvalues[u];
+    if (a.vexists[u]) ++a.N;
+  }
+}
+
+
+
+
+// APPLY-BATCH-UPDATE-SLACK
+// ------------------------
+// Only rows with updates are touched, so an update takes time proportional to
+// the batch (and degrees of its source vertices), not the graph. Each row is
+// merged with its batch into a per-thread buffer, and written back in place,
+// or at the end of the edge arrays (with twice the capacity it needs) if it
+// does not fit. Space of moved rows is not reused, until the graph is rebuilt.
+
+/**
+ * Apply a batch update in place to a CSR graph with slack.
+ * @param a CSR graph with slack (updated, edges sorted)
+ * @param deletions edge deletions (tidy, vertices less than span)
+ * @param insertions edge insertions (tidy, vertices less than span)
+ * @param fc called with each deleted, or inserted edge (u, v, w, inserted?), concurrently for different u
+ */
+template <class K, class V, class E, class O, class FC>
+void applyBatchUpdateSlackOmpU(DiGraphCsrSlack<K, V, E, O>& a, const vector<tuple<K, K>>& deletions, const vector<tuple<K, K, E>>& insertions, FC fc) {
+  vector<K> us;
+  batchUpdateSourcesW(us, deletions, insertions);
+  size_t U = us.size();
+  vector<O> on(U);
+  O end = O(a.ekeys.size());
+  for (size_t i=0; i<U; ++i) {
+    K u = us[i];
+    auto [ib, ie] = batchUpdateRange(insertions, u);
+    O d = a.degrees[u] + O(ie - ib);
+    on[i] = a.offsets[u];
+    if (d <= a.capacities[u]) continue;
+    a.capacities[u] = 2*d;
+    on[i] = end;
+    end  += 2*d;
+  }
+  a.ekeys.resize(end);
+  a.evalues.resize(end);
+  int64_t dm = 0;
+  #pragma omp parallel reduction(+:dm)
+  {
+    vector<pair<K, E>> buf;
+    #pragma omp for schedule(dynamic, 64)
+    for (size_t i=0; i<U; ++i) {
+      K u = us[i];
+      buf.clear();
+      applyBatchUpdateDo(a, u, deletions, insertions, [&](auto v, auto w) { buf.push_back({v, w}); }, [&](auto v, auto w, bool ins) { fc(u, v, w, ins); });
+      O j = on[i];
+      for (const auto& [v, w] : buf) {
+        a.ekeys[j]   = v;
+        a.evalues[j] = w; ++j;
+      }
+      dm += int64_t(buf.size()) - int64_t(a.degrees[u]);
+      a.offsets[u] = on[i];
+      a.degrees[u] = O(buf.size());
+    }
+  }
+  for (K u : us) {
+    if (a.vexists[u] || a.degrees[u]==0) continue;
+    a.vexists[u] = true; ++a.N;
+  }
+  a.M += dm;
+}